@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ *
+ * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
+ * @date 3/24/2008
+ */
+
+//
+// single-threaded micro benchmarks for the B+tree search paths.
+// every benchmark times the current code next to the simpler code it
+// replaced, on the same keys, and prints both.
+//
+// usage: btreebench [-l lookups] [-n entries] [index file ...]
+//
+// for each index file given, it also counts the leaves that are searched
+// by interpolation.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <vector>
+#include "BTreeIndex.h"
+#include "BTreeNode.h"
+#include "KeySearch.h"
+#include "PageFile.h"
+
+using namespace std;
+
+// the number of lookups each benchmark times
+static int lookups = 10000000;
+
+// the number of entries of the index the lookups are timed on
+static int entries = 2000000;
+
+static const char* INDEX_FILE = "btreebench.idx";
+
+// keeps the compiler from dropping the searches whose results are unused
+static volatile long long sink;
+
+/*
+ * The current time in seconds.
+ */
+static double now()
+{
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Make count random search keys between lo and hi.
+ */
+static vector<int> randomKeys(int count, int lo, int hi)
+{
+    vector<int> keys(count);
+    unsigned seed = 12345;
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        keys[i] = lo + (int) ((seed >> 4) % ((unsigned) (hi - lo) + 1));
+    }
+    return keys;
+}
+
+/*
+ * The child search BTNonLeafNode::locateChildPtr() did before
+ * keyUpperBound(): a loop to the first key larger than key.
+ */
+__attribute__((noinline))
+static int scalarUpperBound(const int* keys, int n, int key)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+        if (key < keys[i]) {
+            break;
+        }
+    }
+    return i;
+}
+
+/*
+ * Time searches of a full nonleaf node with and without entry counts,
+ * with the scalar loop and with keyUpperBound().
+ */
+static void benchKeySearch()
+{
+    vector<int> search = randomKeys(1 << 16, 0, 1000000);
+    int sizes[] = { MAX_KEYS, MAX_COUNTED_KEYS };
+
+    fprintf(stdout, "nonleaf node key search:\n");
+    for (int s = 0; s < 2; s++) {
+        int n = sizes[s];
+        vector<int> keys(n);
+        for (int i = 0; i < n; i++) {
+            keys[i] = (long long) (i + 1) * 1000000 / (n + 1);
+        }
+
+        long long sum = 0;
+        double start = now();
+        for (int i = 0; i < lookups; i++) {
+            sum += scalarUpperBound(&keys[0], n, search[i & 0xffff]);
+        }
+        double scalar = now() - start;
+
+        start = now();
+        for (int i = 0; i < lookups; i++) {
+            sum -= keyUpperBound(&keys[0], n, search[i & 0xffff]);
+        }
+        double kernel = now() - start;
+        sink = sum;  // 0 if the two agree
+
+        fprintf(stdout, "  %3d keys: scalar loop %6.1f M/s, keyUpperBound %6.1f M/s%s\n", n,
+            lookups / scalar / 1e6, lookups / kernel / 1e6, sum ? "  MISMATCH" : "");
+    }
+}
+
+/*
+ * Time searches of a 256-key leaf with keyLowerBound(), which binary
+ * searches an array that long, and with keyLowerBoundNear() within the
+ * error bound of the interpolation model. Once with evenly spread keys
+ * and once with keys that grow geometrically.
+ */
+static void benchInterpolation()
+{
+    const int n = 256;
+    vector<int> keys(n);
+    vector<int> search = randomKeys(1 << 16, 0, n - 1);
+
+    fprintf(stdout, "leaf key search, %d keys:\n", n);
+    for (int skewed = 0; skewed <= 1; skewed++) {
+        vector<int> jitter = randomKeys(n, 0, 2);
+        for (int i = 0; i < n; i++) {
+            keys[i] = skewed ? (int) pow(1.04, i) : 1000 + 3 * i + jitter[i];
+        }
+        sort(keys.begin(), keys.end());
+        int error = keyModelError(&keys[0], n);
+
+        // look up keys of the leaf
+        vector<int> present(search.size());
+        for (size_t i = 0; i < search.size(); i++) {
+            present[i] = keys[search[i]];
+        }
+
+        long long sum = 0;
+        double start = now();
+        for (int i = 0; i < lookups; i++) {
+            sum += keyLowerBound(&keys[0], n, present[i & 0xffff]);
+        }
+        double binary = now() - start;
+
+        start = now();
+        for (int i = 0; i < lookups; i++) {
+            sum -= keyLowerBoundNear(&keys[0], n, present[i & 0xffff], error);
+        }
+        double near = now() - start;
+        sink = sum;  // 0 if the two agree
+
+        fprintf(stdout, "  %s keys, error bound %d: binary %5.1f ns, interpolation %5.1f ns%s\n",
+            skewed ? "skewed" : "even", error, binary / lookups * 1e9, near / lookups * 1e9,
+            sum ? "  MISMATCH" : "");
+    }
+}
+
+/*
+ * Count the leaves of an index file that store an interpolation model.
+ */
+static void countLeafModels(const char* indexname)
+{
+    PageFile pf;
+    char page[PageFile::PAGE_SIZE];
+    const BTLeafPageHeader* header = (const BTLeafPageHeader*) page;
+    int leaves = 0;
+    int models = 0;
+
+    if (pf.open(indexname, 'r') != 0) {
+        fprintf(stderr, "cannot open %s\n", indexname);
+        return;
+    }
+    // page 0 holds the metadata of the index
+    for (PageId pid = 1; pid < pf.endPid(); pid++) {
+        if (pf.read(pid, page) == 0 && header->node.type == IS_LEAF) {
+            leaves++;
+            models += header->modelError != 0;
+        }
+    }
+    pf.close();
+    fprintf(stdout, "  %s: %d of %d leaves searched by interpolation\n", indexname, models, leaves);
+}
+
+/*
+ * Time locate() on a bulk-loaded index with no nonleaf level pinned, so
+ * that every node is read through the PageFile, with the default number
+ * of levels pinned, and with all of them pinned, so that a lookup follows
+ * the child pointers of the pinned nodes down to its leaf. Once for keys
+ * that fall in a few leaves and once for keys spread over all of them.
+ * A lookup goes down the whole tree, so a tenth as many are timed as in
+ * the other benchmarks.
+ */
+static void benchLookups()
+{
+    BTreeIndex index;
+    int count = max(1, lookups / 10);
+    int levels[] = { 0, BTreeIndex::DEFAULT_PINNED_LEVELS, INT_MAX };
+
+    unlink(INDEX_FILE);
+    if (index.open(INDEX_FILE, 'w') != 0 || index.bulkLoadBegin(1.0) != 0) {
+        fprintf(stderr, "cannot create %s\n", INDEX_FILE);
+        return;
+    }
+    for (int i = 0; i < entries; i++) {
+        RecordId rid = { i / 16, i % 16 };
+        index.bulkLoadAppend(i, rid);
+    }
+    index.bulkLoadEnd();
+
+    fprintf(stdout, "index lookups, %d entries:\n", entries);
+    for (int hot = 1; hot >= 0; hot--) {
+        vector<int> search = randomKeys(1 << 16, 0, hot ? min(entries, 10000) - 1 : entries - 1);
+        for (int l = 0; l < 3; l++) {
+            index.setPinnedLevels(levels[l]);
+            IndexCursor cursor;
+            int missing = 0;
+            double start = now();
+            for (int i = 0; i < count; i++) {
+                missing += index.locate(search[i & 0xffff], cursor) != 0;
+            }
+            double seconds = now() - start;
+
+            char pinned[16];
+            sprintf(pinned, levels[l] == INT_MAX ? "all" : "%d", levels[l]);
+            fprintf(stdout, "  %s leaves, %3s levels pinned: %5.2f M lookups/s, %zu KB pinned%s\n",
+                hot ? "hot   " : "random", pinned, count / seconds / 1e6, index.getPinnedBytes() / 1024,
+                missing ? "  MISSING KEYS" : "");
+        }
+    }
+
+    index.close();
+    unlink(INDEX_FILE);
+}
+
+int main(int argc, char* argv[])
+{
+    int c;
+
+    while ((c = getopt(argc, argv, "l:n:")) != -1) {
+        switch (c) {
+        case 'l': lookups = max(1, atoi(optarg)); break;
+        case 'n': entries = max(1, atoi(optarg)); break;
+        default:
+            fprintf(stderr, "usage: %s [-l lookups] [-n entries] [index file ...]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    benchKeySearch();
+    benchInterpolation();
+    benchLookups();
+    if (optind < argc) {
+        fprintf(stdout, "leaf interpolation models:\n");
+        for (int i = optind; i < argc; i++) {
+            countLeafModels(argv[i]);
+        }
+    }
+    return 0;
+}
@@ -7,12 +7,93 @@
  * @date 3/24/2008
  */
  
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <thread>
 #include "BTreeIndex.h"
 #include "BTreeNode.h"
 
 using namespace std;
 
 const int RC_SPLIT = 401;
+const int RC_RESTART = 402;
+const int RC_UNDERFLOW = 403;
+
+// a leaf less full than this takes entries from a sibling or is merged into it
+const double LEAF_MIN_FILL = 0.5;
+
+/*
+ * The layout of a page on the free list.
+ */
+typedef struct {
+    BTNodeHeader header;  // type is IS_FREE
+    PageId nextFree;      // the next page on the free list, -1 at the end
+    char unused[PageFile::PAGE_SIZE - sizeof(BTNodeHeader) - sizeof(PageId)];
+} BTFreePage;
+
+//
+// a latch is a version number that a writer makes odd while it writes the
+// nodes the latch covers, and even again when it is done. a reader takes
+// the version before it reads a node and uses what it read only if the
+// version is still the same afterwards, so readers never block writers.
+//
+// writers take latches in two ways. an insert or remove that only changes
+// its leaf reads the leaf like a reader and upgrades the latch to write it
+// if the leaf has not changed since (upgradeLatch). any other write holds
+// the latches of the nodes on its path (holdLatch), remembering the version
+// each had, and lets go of the ones above a node that will take the change
+// by putting that version back (releaseUnchanged), so the readers of those
+// nodes do not start over.
+//
+
+// take the version of a latch to read its nodes.
+// return false if a writer holds it.
+static bool readLatch(atomic<unsigned long long>& latch, unsigned long long& version)
+{
+    version = latch.load(memory_order_acquire);
+    return (version & 1) == 0;
+}
+
+// check that the nodes of a latch were not written since version was taken
+static bool validate(atomic<unsigned long long>& latch, unsigned long long version)
+{
+    atomic_thread_fence(memory_order_acquire);
+    return latch.load(memory_order_relaxed) == version;
+}
+
+// take a latch for writing if it is still at version
+static bool upgradeLatch(atomic<unsigned long long>& latch, unsigned long long version)
+{
+    return latch.compare_exchange_strong(version, version + 1, memory_order_acquire);
+}
+
+// take a latch for writing, waiting for other writers.
+// return the version it had before.
+static unsigned long long writeLatch(atomic<unsigned long long>& latch)
+{
+    for (;; this_thread::yield()) {
+        unsigned long long version = latch.load(memory_order_relaxed);
+        if ((version & 1) == 0 && latch.compare_exchange_weak(version, version + 1, memory_order_acquire)) {
+            return version;
+        }
+    }
+}
+
+// release a latch taken for writing
+static void unlatch(atomic<unsigned long long>& latch)
+{
+    latch.fetch_add(1, memory_order_release);
+}
+
+/*
+ * Orders the positions of a key array by the keys at them.
+ */
+struct KeyOrder {
+    const int* keys;
+    KeyOrder(const int* k) : keys(k) {}
+    bool operator()(int a, int b) const { return keys[a] < keys[b]; }
+};
 
 /*
  * BTreeIndex constructor
@@ -20,6 +101,18 @@ const int RC_SPLIT = 401;
 BTreeIndex::BTreeIndex()
 {
     rootPid = -1;
+    lastLeafPid = -1;
+    treeHeight = 0;
+    freePid = -1;
+    valuePrefix = 0;
+    entryCounts = false;
+    pinnedLevels = DEFAULT_PINNED_LEVELS;
+    for (int i = 0; i < LATCH_STRIPES; i++) {
+        nodeLatches[i] = 0;
+    }
+    metaLatch = 0;
+    pinGeneration = 0;
+    pinnedRoot = NULL;
 }
 
 /*
@@ -32,22 +125,28 @@ BTreeIndex::BTreeIndex()
 RC BTreeIndex::open(const string& indexname, char mode)
 {
     RC pfRC = pf.open(indexname, mode);
+    if (pfRC != 0) {
+        return pfRC;
+    }
 
     if (pf.endPid() == 0) {
         TreeIndexMetadata buffer;
+        memset(&buffer, 0, sizeof(buffer));
         buffer.rootPid = 1;
         buffer.treeHeight = 1;
+        buffer.freePid = -1;
         int error = pf.write(0, (void *) &buffer);
         if (error != 0)
             return error;
 
         rootPid = buffer.rootPid;
+        treeHeight = buffer.treeHeight;
+        freePid = buffer.freePid;
+        valuePrefix = 0;
+        entryCounts = false;
         BTLeafNode leaf;
         return leaf.write(rootPid, pf);
     } else {
-        if (pfRC != 0) {
-            return pfRC;
-        }
         TreeIndexMetadata buffer;
         pfRC = pf.read(0, (void *) &buffer);
         if (pfRC != 0) {
@@ -55,6 +154,9 @@ RC BTreeIndex::open(const string& indexname, char mode)
         }
         rootPid = buffer.rootPid;
         treeHeight = buffer.treeHeight;
+        freePid = buffer.freePid;
+        valuePrefix = buffer.valuePrefix;
+        entryCounts = (buffer.flags & INDEX_ENTRY_COUNTS) != 0;
         return 0;
     }
 }
@@ -66,13 +168,74 @@ RC BTreeIndex::open(const string& indexname, char mode)
 RC BTreeIndex::close()
 {
     TreeIndexMetadata buffer;
+    memset(&buffer, 0, sizeof(buffer));
     buffer.rootPid = rootPid;
     buffer.treeHeight = treeHeight;
+    buffer.freePid = freePid;
+    buffer.valuePrefix = valuePrefix;
+    buffer.flags = entryCounts ? INDEX_ENTRY_COUNTS : 0;
     RC pfRC = pf.write(0, (void *) &buffer);
-    if (pfRC != 0) {
-        return pfRC;
+    freePinned();
+    lastLeafPid = -1;
+
+    // close the file even if the metadata could not be written,
+    // e.g., because the index was opened in 'r' mode
+    RC closeRC = pf.close();
+    return pfRC != 0 ? pfRC : closeRC;
+}
+
+/*
+ * Make the index a covering index that keeps value prefixes of the given
+ * length in its leaves. The index must be empty.
+ * @param length[IN] the prefix length, between 0 (none) and MAX_VALUE_PREFIX
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::setValuePrefix(int length)
+{
+    // an empty index is a single empty leaf, the root
+    BTLeafNode root;
+    RC error;
+    if (treeHeight != 1 || (error = root.read(rootPid, pf)) != 0 || root.getKeyCount() != 0) {
+        return RC_INVALID_FILE_MODE;
+    }
+    if ((error = root.setValuePrefix(length)) != 0 || (error = root.write(rootPid, pf)) != 0) {
+        return error;
+    }
+    valuePrefix = length;
+    return 0;
+}
+
+/*
+ * @return the length of the value prefixes the leaves keep, 0 if none
+ */
+int BTreeIndex::getValuePrefix() const
+{
+    return valuePrefix;
+}
+
+/*
+ * Make the nonleaf nodes of the index keep the entry counts of their
+ * children, or stop them from doing so. The index must be empty.
+ * @param on[IN] whether to keep entry counts
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::setEntryCounts(bool on)
+{
+    // an empty index is a single empty leaf, the root
+    BTLeafNode root;
+    if (treeHeight != 1 || root.read(rootPid, pf) != 0 || root.getKeyCount() != 0) {
+        return RC_INVALID_FILE_MODE;
     }
-    return pf.close();
+    entryCounts = on;
+    return 0;
+}
+
+/*
+ * @return whether the nonleaf nodes keep the entry counts of their children
+ */
+bool BTreeIndex::hasEntryCounts() const
+{
+    return entryCounts;
 }
 
 /*
@@ -83,220 +246,1667 @@ RC BTreeIndex::close()
  */
 RC BTreeIndex::insert(int key, const RecordId& rid)
 {
-    BTLeafNode leaf;
-    BTNonLeafNode nonLeaf;
+    return insert(key, rid, NULL);
+}
 
-    if (leaf.read(rootPid, pf) == 0) {
-        BTLeafNode sibling;
-        int siblingKey;
-        int error = leafInsert(leaf, key, rid, sibling, siblingKey);
-        int writeError;
-
-        // If there is a split
-        if (error == RC_SPLIT) {
-
-            // Write the sibling with the end pid, make sure no errors
-            int siblingPid = pf.endPid();
-            writeError = sibling.write(siblingPid, pf);
-            if (writeError != 0)
-                return writeError;
-
-            sibling.setNextNodePtr(leaf.getNextNodePtr());
-            leaf.setNextNodePtr(siblingPid);
-            int oldRoot = rootPid;
-            writeError = leaf.write(oldRoot, pf);
-            if (writeError != 0)
-                return writeError;
-
-            // Get the next last pid, write the index with that pid
-            rootPid = pf.endPid();
-            nonLeaf.initializeRoot(oldRoot, siblingKey, siblingPid);
-            return nonLeaf.write(rootPid, pf);
-
-        } else if (error == 0) {
-            // Otherwise, write the updated leaf
-            return leaf.write(rootPid, pf);
-        } else {
+/*
+ * Insert (key, RecordId) pair to the index, along with the value of the tuple.
+ * @param key[IN] the key for the value inserted into the index
+ * @param rid[IN] the RecordId for the record being inserted into the index
+ * @param value[IN] the value of the tuple, NULL if it is not known
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::insert(int key, const RecordId& rid, const char* value)
+{
+    // without entry counts, most inserts only change their leaf. such an
+    // insert latches nothing but the leaf, and only once it has the entry
+    // in place. with them, every insert changes the counts on its path up
+    // to the root.
+    while (!entryCounts) {
+        PageId pid;
+        BTLeafNode leaf;
+        unsigned long long version;
+        if (!readLastLeaf(key, pid, leaf, version)) {
+            RC error = findAndReadLeaf(key, false, pid, leaf, version);
+            if (error != 0) {
+                return error;
+            }
+            if (leaf.getNextNodePtr() == -1) {
+                lastLeafPid.store(pid, memory_order_release);
+            }
+        }
+        if (!upgradeLatch(latchOf(pid), version)) {
+            continue;  // the leaf changed since it was read
+        }
+        RC error = leaf.insert(key, rid, value);
+        if (error == 0) {
+            error = leaf.write(pid, pf);
+        }
+        unlatch(latchOf(pid));
+        if (error != RC_NODE_FULL) {
             return error;
         }
+        break;
+    }
+
+    // inserts that change nonleaf nodes run one at a time
+    lock_guard<mutex> guard(writeMutex);
+    return insertOne(key, rid, value);
+}
 
+/*
+ * Read the last leaf seen by an insert, if key belongs in it, without
+ * going down the tree. Nothing tells the leaf when it stops being the
+ * last one: it is checked instead. A leaf that has no next leaf is the
+ * last leaf, and holds every key from its separator on, so every key
+ * from its first key on. A split gives it a next leaf and a merge frees
+ * it, so either way the check fails and the insert goes down the tree.
+ * @return whether key belongs in the leaf read. pid, leaf and version
+ *         are as findAndReadLeaf() returns them
+ */
+bool BTreeIndex::readLastLeaf(int key, PageId& pid, BTLeafNode& leaf, unsigned long long& version)
+{
+    pid = lastLeafPid.load(memory_order_acquire);
+    if (pid < 0 || !readLatch(latchOf(pid), version)) {
+        return false;
+    }
+    int firstKey;
+    RecordId rid;
+    bool last = leaf.read(pid, pf) == 0 && leaf.getNextNodePtr() == -1 &&
+                leaf.readEntry(0, firstKey, rid) == 0 && firstKey <= key;
+    return validate(latchOf(pid), version) && last;
+}
 
-    } else if (nonLeaf.read(rootPid, pf) == 0) {
-        BTNonLeafNode sibling;
-        int midkey;
-        int error = indexInsert(nonLeaf, rootPid, key, rid, sibling, midkey);
+/*
+ * Insert (key, rid) into the tree, latching the nodes on its path
+ * from the top down. The caller holds writeMutex.
+ */
+RC BTreeIndex::insertOne(int key, const RecordId& rid, const char* value)
+{
+    vector<LatchHold> held;
+    int count, splitKey, splitCount;
+    PageId splitPid;
+    RC error = insertInto(rootPid, 0, true, key, rid, value, count, splitKey, splitPid, splitCount, held);
+    if (error == RC_SPLIT) {
+        // the root split: a new root on top of the two halves makes the tree
+        // one level taller. every node is now one level deeper, so the pinned
+        // nodes are pinned afresh.
+        BTNonLeafNode root(entryCounts);
+        root.initializeRoot(rootPid, count, splitKey, splitPid, splitCount);
+        PageId newRootPid;
+        error = allocatePage(newRootPid);
+        if (error == 0) {
+            error = root.write(newRootPid, pf);
+        }
+        if (error == 0) {
+            writeLatch(metaLatch);
+            unpinAll();
+            rootPid = newRootPid;
+            treeHeight++;
+            unlatch(metaLatch);
+        }
+    }
+    releaseLatches(held);
+    return error;
+}
 
-        if (error == RC_SPLIT) {
-            int writeError;
+/*
+ * Insert a batch of (key, RecordId) pairs given in key order.
+ * @param keys[IN] the keys, in ascending order
+ * @param rids[IN] the RecordIds for the records with the keys
+ * @param values[IN] the values of the tuples, NULL if they are not known
+ * @param n[IN] the number of pairs
+ * @return error code. RC_UNSORTED_INPUT if the keys are not in order
+ */
+RC BTreeIndex::insertBatch(const int* keys, const RecordId* rids, const char* const* values, int n)
+{
+    for (int i = 1; i < n; i++) {
+        if (keys[i] < keys[i - 1]) {
+            return RC_UNSORTED_INPUT;
+        }
+    }
+    lock_guard<mutex> guard(writeMutex);
+    return insertSorted(keys, rids, values, n);
+}
 
-            // Write the sibling
-            int siblingPid = pf.endPid();
-            writeError = sibling.write(siblingPid, pf);
-            if (writeError != 0)
-                return writeError;
+/*
+ * Insert the pairs of a batch in key order. Each pass down the tree puts
+ * in the run of pairs that belong to one leaf, as many as the leaf takes.
+ * A pair that finds its leaf full goes in on its own, splitting the leaf.
+ * The caller holds writeMutex.
+ */
+RC BTreeIndex::insertSorted(const int* keys, const RecordId* rids, const char* const* values, int n)
+{
+    for (int i = 0; i < n; ) {
+        vector<LatchHold> held;
+        int done, count;
+        RC error = insertRunInto(rootPid, 0, keys + i, rids + i, values != NULL ? values + i : NULL,
+                                 n - i, (long long) INT_MAX + 1, done, count, held);
+        releaseLatches(held);
+        if (error != 0) {
+            return error;
+        }
+        if (done == 0) {
+            if ((error = insertOne(keys[i], rids[i], values != NULL ? values[i] : NULL)) != 0) {
+                return error;
+            }
+            done = 1;
+        }
+        i += done;
+    }
+    return 0;
+}
 
-            // Save oldRoot's pid, and write the new nonLeaf
-            int oldRoot = rootPid;
-            writeError = nonLeaf.write(oldRoot, pf);
-            if (writeError != 0)
-                return  writeError;
+/*
+ * Insert the first pairs of the sorted run (keys, rids, values) of length n
+ * into the subtree rooted at the node pid at the given depth: those that
+ * go to the leaf keys[0] goes to, i.e., those smaller than bound, until the
+ * leaf is full. Every node is latched before it is read, and the latches
+ * are added to held. done is set to the number of pairs inserted and count
+ * to the number of entries the subtree holds afterwards.
+ */
+RC BTreeIndex::insertRunInto(PageId pid, int depth, const int* keys, const RecordId* rids,
+                             const char* const* values, int n, long long bound,
+                             int& done, int& count, vector<LatchHold>& held)
+{
+    RC error;
 
-            // Update rootPid and save the new root
-            rootPid = pf.endPid();
-            BTNonLeafNode root;
-            root.initializeRoot(oldRoot, midkey, siblingPid);
-            return root.write(rootPid, pf);
-        } else if (error == 0) {
-            return nonLeaf.write(rootPid, pf);
+    done = 0;
+    if (depth == treeHeight - 1) {
+        BTLeafNode leaf;
+        holdLatch(pid, held);
+        if ((error = leaf.read(pid, pf)) != 0) {
+            return error;
+        }
+        for (; done < n && keys[done] < bound; done++) {
+            error = leaf.insert(keys[done], rids[done], values != NULL ? values[done] : NULL);
+            if (error == RC_NODE_FULL) {
+                break;
+            } else if (error != 0) {
+                return error;
+            }
         }
+        count = leaf.getKeyCount();
+        return done > 0 ? leaf.write(pid, pf) : 0;
+    }
+
+    // a run fills its leaf without splitting it, so without entry counts
+    // the nonleaf nodes do not change. they only ever change under
+    // writeMutex, which the caller holds, so they need no latch either.
+    BTNonLeafNode node;
+    if (entryCounts) {
+        holdLatch(pid, held);
+    }
+    if ((error = readNonLeaf(pid, depth, node)) != 0) {
         return error;
+    }
 
-    } else {
-        // Flag was incorrectly set, therefore must be an invalid pid
-        return RC_INVALID_PID;
+    // insert() routes a key equal to a separator key to the right of it,
+    // so the child takes the keys below the separator behind it
+    int first, child;
+    node.locateChildRange(keys[0], first, child);
+    long long childBound = bound;
+    if (child < node.getKeyCount()) {
+        childBound = min(bound, (long long) node.getKey(child));
     }
-}
 
-RC BTreeIndex::indexInsert(BTNonLeafNode& index, PageId pid, int key, const RecordId& rid, BTNonLeafNode& sibling, int& midKey)
-{
-    int newPid;
-    int error;
-    error = index.locateChildPtr(key, newPid);
-    if (error != 0) {
+    int childCount;
+    error = insertRunInto(node.getChildPtr(child), depth + 1, keys, rids, values, n, childBound,
+                          done, childCount, held);
+    if (error != 0 || done == 0 || !entryCounts) {
         return error;
     }
+    node.setEntryCount(child, childCount);
+    count = node.getTotalCount();
+    return writeNonLeaf(pid, depth, node);
+}
+
+/*
+ * Insert (key, rid) into the subtree rooted at the node pid at the given depth.
+ * Every node is latched before it is read, and the latches are added to held.
+ * With entry counts, count is set to the number of entries the subtree
+ * holds afterwards. If the node has to split, the new right half is
+ * written to splitPid, splitKey is set to the key its parent should route
+ * to it by, splitCount to the number of entries in it, and RC_SPLIT is
+ * returned.
+ * last tells whether the node is the last one of its level. A full last
+ * node that gets a key at its end keeps its entries and starts a new last
+ * node with the key, so an index that grows in key order fills its nodes.
+ */
+RC BTreeIndex::insertInto(PageId pid, int depth, bool last, int key, const RecordId& rid, const char* value,
+                          int& count, int& splitKey, PageId& splitPid, int& splitCount,
+                          vector<LatchHold>& held)
+{
+    RC error;
 
+    holdLatch(pid, held);
+    if (depth == treeHeight - 1) {
+        BTLeafNode leaf;
+        if ((error = leaf.read(pid, pf)) != 0) {
+            return error;
+        }
+        error = leaf.insert(key, rid, value);
+        if (error == 0) {
+            count = leaf.getKeyCount();
+            return leaf.write(pid, pf);
+        } else if (error != RC_NODE_FULL) {
+            return error;
+        }
 
-    BTLeafNode leaf;
-    BTNonLeafNode nonLeaf;
-
-    if (leaf.read(newPid, pf) == 0) {
-        BTLeafNode leafS;
-        int siblingKey;
-        error = leafInsert(leaf, key, rid, leafS, siblingKey);
-
-        // If the leaf splits, write the leaf and its sibling
-        if (error == RC_SPLIT) {
-            int siblingPid = pf.endPid();
-            leafS.setNextNodePtr(leaf.getNextNodePtr());
-            leaf.setNextNodePtr(siblingPid);
-            leafS.write(siblingPid, pf);
-            leaf.write(newPid, pf);
-
-            int nonLeafError = index.insert(siblingKey, siblingPid);
-            if (nonLeafError == RC_NODE_FULL) {
-                index.insertAndSplit(siblingKey, siblingPid, sibling, midKey);
-                return RC_SPLIT;
-            } else if (nonLeafError == 0){
-                return 0;
-            } else {
-                return nonLeafError;
-            }
-        } else if (error == 0) {
-            leaf.write(newPid, pf);
-            return 0;
+        BTLeafNode sibling;
+        if ((!last || leaf.appendAndSplit(key, rid, value, sibling, splitKey) != 0) &&
+            (error = leaf.insertAndSplit(key, rid, value, sibling, splitKey)) != 0) {
+            return error;
+        }
+        count = leaf.getKeyCount();
+        splitCount = sibling.getKeyCount();
+        if ((error = allocatePage(splitPid)) != 0) {
+            return error;
+        }
+        sibling.setNextNodePtr(leaf.getNextNodePtr());
+        sibling.setPrevNodePtr(pid);
+        leaf.setNextNodePtr(splitPid);
+        if ((error = sibling.write(splitPid, pf)) != 0) {
+            return error;
+        }
+        if ((error = leaf.write(pid, pf)) != 0) {
+            return error;
         }
-        return error;
 
-    } else if (nonLeaf.read(newPid, pf) == 0) {
-        BTNonLeafNode nonLeafSibling;
-        int siblingKey;
-        error = indexInsert(nonLeaf, newPid, key, rid, nonLeafSibling, siblingKey);
-
-        if (error == RC_SPLIT) {
-            nonLeaf.write(newPid, pf);
-            int siblingPid = pf.endPid();
-            nonLeafSibling.write(siblingPid, pf);
-
-            int nonLeafError = index.insert(siblingKey, siblingPid);
-            if (nonLeafError == RC_NODE_FULL) {
-                index.insertAndSplit(siblingKey, siblingPid, sibling, midKey);
-                return RC_SPLIT;
-            } else if (nonLeafError == 0){
-                return 0;
-            } else {
-                return nonLeafError;
+        // the leaf that followed the split leaf now follows the sibling.
+        // with none, the sibling is the new last leaf. its latch keeps the
+        // inserts that find it by lastLeafPid out until its parent points to it.
+        PageId nextPid = sibling.getNextNodePtr();
+        if (nextPid == -1) {
+            holdLatch(splitPid, held);
+            lastLeafPid.store(splitPid, memory_order_release);
+        } else {
+            BTLeafNode next;
+            holdLatch(nextPid, held);
+            if ((error = next.read(nextPid, pf)) != 0) {
+                return error;
+            }
+            next.setPrevNodePtr(splitPid);
+            if ((error = next.write(nextPid, pf)) != 0) {
+                return error;
             }
         }
+        return RC_SPLIT;
+    }
+
+    BTNonLeafNode node;
+    if ((error = readNonLeaf(pid, depth, node)) != 0) {
+        return error;
+    }
+    int first, child;
+    node.locateChildRange(key, first, child);
+    PageId childPid = node.getChildPtr(child);
+
+    // without entry counts, a node with room for one more key takes the
+    // split of its child, so the nodes above it will not change and can
+    // be let go
+    if (!entryCounts && node.getKeyCount() < node.getMaxKeyCount()) {
+        releaseUnchanged(held, pid);
+    }
+
+    int childCount, childKey, childSplitCount;
+    PageId childSplitPid;
+    bool lastChild = (child == node.getKeyCount());
+    error = insertInto(childPid, depth + 1, last && lastChild, key, rid, value, childCount,
+                       childKey, childSplitPid, childSplitCount, held);
+    if (error != 0 && error != RC_SPLIT) {
+        return error;
+    } else if (error == 0 && !entryCounts) {
+        return 0;  // the node does not change
+    }
+    node.setEntryCount(child, childCount);
+
+    // if the child split, route to its new right half from this node
+    if (error == 0 || (error = node.insertBehind(child, childKey, childSplitPid, childSplitCount)) == 0) {
+        count = node.getTotalCount();
+        return writeNonLeaf(pid, depth, node);
+    } else if (error != RC_NODE_FULL) {
         return error;
+    }
+
+    BTNonLeafNode sibling(entryCounts);
+    if (last && lastChild) {
+        error = node.appendAndSplit(childKey, childSplitPid, childSplitCount, sibling, splitKey);
     } else {
-        // Flag was incorrectly set, therefore must be an invalid pid
-        return RC_INVALID_PID;
+        error = node.insertBehindAndSplit(child, childKey, childSplitPid, childSplitCount,
+                                          sibling, splitKey);
+    }
+    if (error != 0) {
+        return error;
+    }
+    count = node.getTotalCount();
+    splitCount = sibling.getTotalCount();
+    if ((error = allocatePage(splitPid)) != 0) {
+        return error;
     }
+    if ((error = writeNonLeaf(splitPid, depth, sibling)) != 0) {
+        return error;
+    }
+    if ((error = writeNonLeaf(pid, depth, node)) != 0) {
+        return error;
+    }
+    return RC_SPLIT;
 }
 
-RC BTreeIndex::leafInsert(BTLeafNode& leaf, int key, const RecordId& rid, BTLeafNode& sibling, int& siblingKey)
+/*
+ * Remove the (key, RecordId) pair from the index.
+ * @param key[IN] the key of the pair to remove
+ * @param rid[IN] the RecordId of the pair to remove
+ * @return error code. RC_NO_SUCH_RECORD if the pair is not in the index
+ */
+RC BTreeIndex::remove(int key, const RecordId& rid)
 {
-    RC error = leaf.insert(key, rid);
+    // like an insert, a remove that leaves its leaf at least half full
+    // latches nothing but the leaf, unless it has to change entry counts
+    while (!entryCounts) {
+        PageId pid;
+        BTLeafNode leaf;
+        unsigned long long version;
+        int eid;
+        RC error = findAndReadLeaf(key, true, pid, leaf, version);
+        if (error != 0) {
+            return error;
+        }
+        if (leaf.locateEntry(key, rid, eid) != 0) {
+            break;  // may be in a leaf to the right, among duplicates of key
+        }
+        leaf.remove(eid);
+        if (leaf.getFillRatio() < LEAF_MIN_FILL && treeHeight > 1) {
+            break;
+        }
+        if (!upgradeLatch(latchOf(pid), version)) {
+            continue;  // the leaf changed since it was read
+        }
+        error = leaf.write(pid, pf);
+        unlatch(latchOf(pid));
+        return error;
+    }
 
-    if (error == RC_NODE_FULL) {
-        error = leaf.insertAndSplit(key, rid, sibling, siblingKey);
-        return error == 0 ? RC_SPLIT : error;
+    lock_guard<mutex> guard(writeMutex);
+    vector<LatchHold> held;
+    int count;
+    RC error = removeFrom(rootPid, 0, true, key, rid, count, held);
+    if (error == RC_UNDERFLOW) {
+        error = 0;
     }
 
+    // a nonleaf root left with a single child is replaced by the child
+    if (error == 0 && treeHeight > 1) {
+        BTNonLeafNode root;
+        PageId oldRootPid = rootPid;
+        error = readNonLeaf(oldRootPid, 0, root);
+        if (error == 0 && root.getKeyCount() == 0) {
+            writeLatch(metaLatch);
+            unpinAll();
+            rootPid = root.getChildPtr(0);
+            treeHeight--;
+            unlatch(metaLatch);
+            error = freePage(oldRootPid);
+        }
+    }
+    releaseLatches(held);
     return error;
 }
 
-/**
- * Run the standard B+Tree key search algorithm and identify the
- * leaf node where searchKey may exist. If an index entry with
- * searchKey exists in the leaf node, set IndexCursor to its location
- * (i.e., IndexCursor.pid = PageId of the leaf node, and
- * IndexCursor.eid = the searchKey index entry number.) and return 0.
- * If not, set IndexCursor.pid = PageId of the leaf node and
- * IndexCursor.eid = the index entry immediately after the largest
- * index key that is smaller than searchKey, and return the error
- * code RC_NO_SUCH_RECORD.
- * Using the returned "IndexCursor", you will have to call readForward()
- * to retrieve the actual (key, rid) pair from the index.
- * @param key[IN] the key to find
- * @param cursor[OUT] the cursor pointing to the index entry with
- *                    searchKey or immediately behind the largest key
- *                    smaller than searchKey.
- * @return 0 if searchKey is found. Othewise an error code
+/*
+ * Remove (key, rid) from the subtree rooted at the node pid at the given depth.
+ * Every node is latched before it is read, and the latches are added to held.
+ * With entry counts, count is set to the number of entries the subtree
+ * holds afterwards. Return RC_UNDERFLOW if the node is left less than half full
+ * and its parent has to fix it.
+ * only tells whether the subtree is the only one on the way down that may
+ * hold the pair. If not, the nodes above may go on to another subtree and
+ * change after all, so their latches are kept.
  */
-RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
+RC BTreeIndex::removeFrom(PageId pid, int depth, bool only, int key, const RecordId& rid, int& count,
+                          vector<LatchHold>& held)
 {
-    return locateFull(searchKey, cursor, rootPid);
-}
+    RC error;
+
+    holdLatch(pid, held);
+    if (depth == treeHeight - 1) {
+        BTLeafNode leaf;
+        int eid;
+        if ((error = leaf.read(pid, pf)) != 0) {
+            return error;
+        }
+        if ((error = leaf.locateEntry(key, rid, eid)) != 0) {
+            return error;
+        }
+        leaf.remove(eid);
+        if ((error = leaf.write(pid, pf)) != 0) {
+            return error;
+        }
+        count = leaf.getKeyCount();
+        return leaf.getFillRatio() < LEAF_MIN_FILL ? RC_UNDERFLOW : 0;
+    }
 
-RC BTreeIndex::locateFull(int searchKey, IndexCursor& cursor, PageId curPid) {
-    BTLeafNode leaf;
     BTNonLeafNode node;
+    if ((error = readNonLeaf(pid, depth, node)) != 0) {
+        return error;
+    }
 
-    if (leaf.read(curPid, pf) == 0) {
-        cursor.pid = curPid;
-        return leaf.locate(searchKey, cursor.eid);
-    } else if (node.read(curPid, pf) == 0) {
-        PageId nextPid;
-        node.locateChildPtr(searchKey, nextPid);
-        return locateFull(searchKey, cursor, nextPid);
+    // duplicates of a separator key may be on both sides of it.
+    // try the children that may hold key from left to right.
+    int first, last;
+    node.locateChildRange(key, first, last);
+
+    // without entry counts, a node that stays at least half full when it
+    // loses a key takes a merge of its children, so the nodes above it
+    // will not change
+    int minKeys = node.getMaxKeyCount() / 2;
+    if (!entryCounts && only && node.getKeyCount() > minKeys) {
+        releaseUnchanged(held, pid);
+    }
+
+    error = RC_NO_SUCH_RECORD;
+    for (int child = first; child <= last && error == RC_NO_SUCH_RECORD; child++) {
+        int childCount;
+        error = removeFrom(node.getChildPtr(child), depth + 1, only && first == last, key, rid,
+                           childCount, held);
+        if (error == 0 && !entryCounts) {
+            return 0;  // the node does not change
+        } else if (error == 0 || error == RC_UNDERFLOW) {
+            bool underflow = (error == RC_UNDERFLOW);
+            node.setEntryCount(child, childCount);
+            if (underflow && (error = fixUnderflow(node, child, depth + 1, held)) != 0) {
+                return error;
+            }
+            if ((error = writeNonLeaf(pid, depth, node)) != 0) {
+                return error;
+            }
+            count = node.getTotalCount();
+            return underflow && node.getKeyCount() < minKeys ? RC_UNDERFLOW : 0;
+        }
     }
-    return RC_INVALID_PID;
+    return error;
 }
 
 /*
- * Read the (key, rid) pair at the location specified by the index cursor,
- * and move foward the cursor to the next entry.
- * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
- * @param key[OUT] the key stored at the index cursor location.
- * @param rid[OUT] the RecordId stored at the index cursor location.
- * @return error code. 0 if no error
+ * The child-th child of node, at the given depth, is less than half full.
+ * Move entries to it from a sibling, or merge the two if they fit in one
+ * node and free the page of the right one. node, with the entry counts
+ * of its children, is updated but not written.
  */
-RC BTreeIndex::readForward(IndexCursor& cursor, int& key, RecordId& rid)
+RC BTreeIndex::fixUnderflow(BTNonLeafNode& node, int child, int depth, vector<LatchHold>& held)
 {
-    if (cursor.pid == -1) {
-        return RC_END_OF_TREE;
+    RC error;
+    if (node.getKeyCount() == 0) {
+        return 0;  // no sibling to go to
     }
-    BTLeafNode leaf;
-    RC leafRC = leaf.read(cursor.pid, pf);
-    if (leafRC != 0) {
-        return leafRC;
+
+    // pair the child with its right sibling, or with its left one if it is the last
+    int left = child < node.getKeyCount() ? child : child - 1;
+    PageId leftPid = node.getChildPtr(left);
+    PageId rightPid = node.getChildPtr(left + 1);
+    holdLatch(leftPid, held);
+    holdLatch(rightPid, held);
+
+    if (depth == treeHeight - 1) {
+        BTLeafNode leftLeaf, rightLeaf;
+        if ((error = leftLeaf.read(leftPid, pf)) != 0 ||
+            (error = rightLeaf.read(rightPid, pf)) != 0) {
+            return error;
+        }
+
+        int rightKey;
+        if (leftLeaf.merge(rightLeaf) == 0) {
+            // unlink the right leaf from the leaf chain and free it
+            PageId nextPid = rightLeaf.getNextNodePtr();
+            leftLeaf.setNextNodePtr(nextPid);
+            if (nextPid != -1) {
+                BTLeafNode next;
+                holdLatch(nextPid, held);
+                if ((error = next.read(nextPid, pf)) != 0) {
+                    return error;
+                }
+                next.setPrevNodePtr(leftPid);
+                if ((error = next.write(nextPid, pf)) != 0) {
+                    return error;
+                }
+            }
+            if ((error = leftLeaf.write(leftPid, pf)) != 0) {
+                return error;
+            }
+            node.setEntryCount(left, leftLeaf.getKeyCount());
+            node.removeKey(left);
+            return freePage(rightPid);
+        } else if ((error = leftLeaf.redistribute(rightLeaf, rightKey)) == 0) {
+            if ((error = leftLeaf.write(leftPid, pf)) != 0 ||
+                (error = rightLeaf.write(rightPid, pf)) != 0) {
+                return error;
+            }
+            node.setEntryCount(left, leftLeaf.getKeyCount());
+            node.setEntryCount(left + 1, rightLeaf.getKeyCount());
+            return node.setKey(left, rightKey);
+        }
+        return error;
     }
-    leafRC = leaf.readEntry(cursor.eid, key, rid);
-    if (leafRC != 0) {
-        return leafRC;
+
+    BTNonLeafNode leftNode, rightNode;
+    if ((error = readNonLeaf(leftPid, depth, leftNode)) != 0 ||
+        (error = readNonLeaf(rightPid, depth, rightNode)) != 0) {
+        return error;
     }
-    leafRC = leaf.getNextCursor(cursor);
-    return leafRC;
+
+    int midKey;
+    if (leftNode.merge(node.getKey(left), rightNode) == 0) {
+        if ((error = writeNonLeaf(leftPid, depth, leftNode)) != 0) {
+            return error;
+        }
+        unpin(rightPid);
+        node.setEntryCount(left, leftNode.getTotalCount());
+        node.removeKey(left);
+        return freePage(rightPid);
+    } else if ((error = leftNode.redistribute(node.getKey(left), rightNode, midKey)) == 0) {
+        if ((error = writeNonLeaf(leftPid, depth, leftNode)) != 0 ||
+            (error = writeNonLeaf(rightPid, depth, rightNode)) != 0) {
+            return error;
+        }
+        node.setEntryCount(left, leftNode.getTotalCount());
+        node.setEntryCount(left + 1, rightNode.getTotalCount());
+        return node.setKey(left, midKey);
+    }
+    return error;
+}
+
+/*
+ * Take a page for a new node from the free list, or from the end of the file.
+ */
+RC BTreeIndex::allocatePage(PageId& pid)
+{
+    if (freePid == -1) {
+        pid = pf.endPid();
+        return 0;
+    }
+
+    BTFreePage page;
+    RC error = pf.read(freePid, (void *) &page);
+    if (error != 0) {
+        return error;
+    }
+    if (page.header.type != IS_FREE) {
+        return RC_INVALID_FILE_FORMAT;
+    }
+    pid = freePid;
+    freePid = page.nextFree;
+    return 0;
+}
+
+/*
+ * Put the page of a node that is no longer in the tree on the free list.
+ */
+RC BTreeIndex::freePage(PageId pid)
+{
+    BTFreePage page;
+    memset(&page, 0, sizeof(page));
+    page.header.type = IS_FREE;
+    page.nextFree = freePid;
+    RC error = pf.write(pid, (const void *) &page);
+    if (error == 0) {
+        freePid = pid;
+    }
+    return error;
+}
+
+/*
+ * Start building the index bottom-up from (key, RecordId) pairs
+ * given in key order.
+ * @param fillFactor[IN] how full to make each node, between 0 and 1
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::bulkLoadBegin(double fillFactor)
+{
+    // only an index that holds nothing but its empty root leaf can be bulk loaded
+    BTLeafNode root;
+    if (rootPid != 1 || pf.endPid() != 2 ||
+        root.read(rootPid, pf) != 0 || root.getKeyCount() != 0) {
+        return RC_INVALID_FILE_MODE;
+    }
+
+    bulkFill = fillFactor;
+    bulkLeaf = BTLeafNode();
+    bulkLeaf.setValuePrefix(valuePrefix);
+    bulkLeafPid = rootPid;
+    bulkLevel.clear();
+    return 0;
+}
+
+/*
+ * Append the next (key, RecordId) pair of a bulk load.
+ * @param key[IN] the key. It must not be smaller than the previous key.
+ * @param rid[IN] the RecordId for the record with the key
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::bulkLoadAppend(int key, const RecordId& rid)
+{
+    return bulkLoadAppend(key, rid, NULL);
+}
+
+/*
+ * Append the next (key, RecordId) pair of a bulk load, along with the value of the tuple.
+ * @param key[IN] the key. It must not be smaller than the previous key.
+ * @param rid[IN] the RecordId for the record with the key
+ * @param value[IN] the value of the tuple, NULL if it is not known
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::bulkLoadAppend(int key, const RecordId& rid, const char* value)
+{
+    if (bulkLeaf.getKeyCount() > 0) {
+        if (key < bulkLastKey) {
+            return RC_UNSORTED_INPUT;
+        }
+
+        // move on to a new leaf once the current one is as full as asked
+        // or cannot take the entry at all. leaves go to consecutive pages,
+        // so the next leaf is always the following page.
+        RC error = bulkLeaf.getFillRatio() >= bulkFill ? RC_NODE_FULL : bulkLeaf.insert(key, rid, value);
+        if (error == 0) {
+            bulkLastKey = key;
+            bulkLevel.back().count++;
+            return 0;
+        } else if (error != RC_NODE_FULL) {
+            return error;
+        }
+        bulkLeaf.setNextNodePtr(bulkLeafPid + 1);
+        error = bulkLeaf.write(bulkLeafPid, pf);
+        if (error != 0) {
+            return error;
+        }
+        bulkLeaf = BTLeafNode();
+        bulkLeaf.setValuePrefix(valuePrefix);
+        bulkLeaf.setPrevNodePtr(bulkLeafPid);
+        bulkLeafPid++;
+    }
+
+    if (bulkLeaf.getKeyCount() == 0) {
+        BulkNode leaf = { key, bulkLeafPid, 0 };
+        bulkLevel.push_back(leaf);
+    }
+    bulkLastKey = key;
+    RC error = bulkLeaf.insert(key, rid, value);
+    if (error == 0) {
+        bulkLevel.back().count++;
+    }
+    return error;
+}
+
+/*
+ * Finish a bulk load: write the last leaf and build the nonleaf levels.
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::bulkLoadEnd()
+{
+    bulkLeaf.setNextNodePtr(-1);
+    RC error = bulkLeaf.write(bulkLeafPid, pf);
+    if (error != 0) {
+        return error;
+    }
+    treeHeight = 1;
+    if (bulkLevel.empty()) {
+        return 0;
+    }
+
+    // each pass turns the list of nodes of one level into
+    // the list of their parents, until only the root is left
+    int perNode = (int) (bulkFill * (BTNonLeafNode(entryCounts).getMaxKeyCount() + 1));
+    if (perNode < 3) {
+        perNode = 3;
+    }
+    while (bulkLevel.size() > 1) {
+        vector<BulkNode> parents;
+        int n = bulkLevel.size();
+
+        // spread the children evenly, so no node is left with a single child
+        int nodes = (n + perNode - 1) / perNode;
+        int next = 0;
+        for (int i = 0; i < nodes; i++) {
+            int end = (int) ((long long) n * (i + 1) / nodes);
+            BTNonLeafNode node(entryCounts);
+            node.initializeRoot(bulkLevel[next].pid, bulkLevel[next].count,
+                                bulkLevel[next + 1].key, bulkLevel[next + 1].pid, bulkLevel[next + 1].count);
+            for (int c = next + 2; c < end; c++) {
+                if ((error = node.insert(bulkLevel[c].key, bulkLevel[c].pid, bulkLevel[c].count)) != 0) {
+                    return error;
+                }
+            }
+
+            BulkNode parent = { bulkLevel[next].key, pf.endPid(), node.getTotalCount() };
+            if ((error = node.write(parent.pid, pf)) != 0) {
+                return error;
+            }
+            parents.push_back(parent);
+            next = end;
+        }
+
+        bulkLevel.swap(parents);
+        treeHeight++;
+    }
+
+    rootPid = bulkLevel[0].pid;
+    bulkLevel.clear();
+    freePinned();
+    return 0;
+}
+
+/**
+ * Run the standard B+Tree key search algorithm and identify the
+ * leaf node where searchKey may exist. If an index entry with
+ * searchKey exists in the leaf node, set IndexCursor to its location
+ * (i.e., IndexCursor.pid = PageId of the leaf node, and
+ * IndexCursor.eid = the searchKey index entry number.) and return 0.
+ * If not, set IndexCursor.pid = PageId of the leaf node and
+ * IndexCursor.eid = the index entry immediately after the largest
+ * index key that is smaller than searchKey, and return the error
+ * code RC_NO_SUCH_RECORD.
+ * Using the returned "IndexCursor", you will have to call readForward()
+ * to retrieve the actual (key, rid) pair from the index.
+ * @param key[IN] the key to find
+ * @param cursor[OUT] the cursor pointing to the index entry with
+ *                    searchKey or immediately behind the largest key
+ *                    smaller than searchKey.
+ * @return 0 if searchKey is found. Othewise an error code
+ */
+RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
+{
+    for (;; this_thread::yield()) {
+        PageId pid;
+        BTLeafNode leaf;
+        unsigned long long version;
+        RC error = findAndReadLeaf(searchKey, true, pid, leaf, version);
+        if (error != 0) {
+            return error;
+        }
+
+        // the first leaf that can hold searchKey may end right before it
+        // when the duplicates of searchKey start in the next leaf. entries
+        // may move between the two meanwhile, so start over unless the leaf
+        // left behind is still as it was read.
+        error = leaf.locate(searchKey, cursor.eid);
+        while (error != 0 && cursor.eid == leaf.getKeyCount() && leaf.getNextNodePtr() != -1) {
+            PageId prevPid = pid;
+            unsigned long long prevVersion = version;
+            pid = leaf.getNextNodePtr();
+            error = readLeaf(pid, leaf, version);
+            if (!validate(latchOf(prevPid), prevVersion)) {
+                error = RC_RESTART;
+                break;
+            }
+            if (error != 0) {
+                return error;
+            }
+            error = leaf.locate(searchKey, cursor.eid);
+        }
+        if (error != RC_RESTART) {
+            cursor.pid = pid;
+            return error;
+        }
+    }
+}
+
+/*
+ * Run locate() for a batch of keys at once, walking the tree once.
+ * @param searchKeys[IN] the keys to find, in any order
+ * @param n[IN] the number of keys
+ * @param cursors[OUT] cursors[i] is set as locate() sets it for searchKeys[i]
+ * @param results[OUT] results[i] is 0 if searchKeys[i] is found,
+ *                     RC_NO_SUCH_RECORD if not
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::locateBatch(const int* searchKeys, int n, IndexCursor* cursors, RC* results)
+{
+    if (n <= 0) {
+        return 0;
+    }
+    vector<int> order(n);
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), KeyOrder(searchKeys));
+
+    // walk the tree again from the root if a writer got in the way
+    for (;;) {
+        unsigned long long meta, version;
+        unsigned long long generation = pinGeneration.load(memory_order_acquire);
+        if (readLatch(metaLatch, meta)) {
+            PageId pid = rootPid;
+            int height = treeHeight;
+            if (readLatch(latchOf(pid), version) && validate(metaLatch, meta)) {
+                PinnedNode* pinnedNode = pinnedLevels > 0 ? pinnedRoot.load(memory_order_acquire) : NULL;
+                RC error = locateBatchIn(pid, version, generation, pinnedNode, 0, height, searchKeys,
+                                         &order[0], n, cursors, results);
+                if (error != RC_RESTART) {
+                    return error;
+                }
+            }
+        }
+        this_thread::yield();
+    }
+}
+
+/*
+ * Locate the keys searchKeys[order[0..n)], which are sorted and all
+ * belong to the subtree rooted at the node pid at the given depth.
+ * version is the version of the node the caller read before it got here,
+ * and generation the generation of the pinned nodes it set out with.
+ * pinnedNode is the pinned copy of the node the caller was led to, or NULL.
+ * Return RC_RESTART if a writer changed a node on the way.
+ */
+RC BTreeIndex::locateBatchIn(PageId pid, unsigned long long version, unsigned long long generation,
+                             PinnedNode* pinnedNode, int depth, int height,
+                             const int* searchKeys, const int* order, int n,
+                             IndexCursor* cursors, RC* results)
+{
+    RC error;
+
+    if (depth == height - 1) {
+        BTLeafNode leaf;
+        error = leaf.read(pid, pf);
+        if (!validate(latchOf(pid), version)) {
+            return RC_RESTART;
+        }
+        if (error != 0) {
+            return error;
+        }
+        for (int i = 0; i < n; i++) {
+            int k = order[i];
+            cursors[k].pid = pid;
+            results[k] = leaf.locate(searchKeys[k], cursors[k].eid);
+            if (results[k] != 0 && cursors[k].eid == leaf.getKeyCount() && leaf.getNextNodePtr() != -1) {
+                results[k] = locate(searchKeys[k], cursors[k]);  // may start in the next leaf
+            }
+        }
+        return 0;
+    }
+
+    BTNonLeafNode copy;
+    BTNonLeafNode* node = &copy;
+    if (pinnedNode != NULL && pinnedNode->holds(pid)) {
+        node = &pinnedNode->node;
+        error = 0;
+    } else {
+        error = readNonLeaf(pid, depth, copy, version, generation);
+    }
+    if (!validate(latchOf(pid), version)) {
+        return RC_RESTART;
+    }
+    if (error != 0) {
+        return error;
+    }
+
+    // the keys are sorted, so the keys routed to a child are next to
+    // each other. hand each such run down to its child in one visit.
+    int begin = 0;
+    int first, last;
+    node->locateChildRange(searchKeys[order[0]], first, last);
+    int child = first;
+    PageId childPid = node->getChildPtr(child);
+    for (int i = 1; i <= n; i++) {
+        PageId nextPid = -1;
+        if (i < n) {
+            node->locateChildRange(searchKeys[order[i]], first, last);
+            nextPid = node->getChildPtr(first);
+        }
+        if (i == n || nextPid != childPid) {
+            PinnedNode* childNode = NULL;
+            if (node != &copy && depth + 1 < height - 1) {
+                childNode = pinnedChild(*pinnedNode, child, depth + 1);
+            }
+
+            // the child is only valid if this node has not changed since it was read
+            unsigned long long childVersion;
+            if (!readLatch(latchOf(childPid), childVersion) || !validate(latchOf(pid), version)) {
+                return RC_RESTART;
+            }
+            error = locateBatchIn(childPid, childVersion, generation, childNode, depth + 1, height,
+                                  searchKeys, order + begin, i - begin, cursors, results);
+            if (error != 0) {
+                return error;
+            }
+            begin = i;
+            child = first;
+            childPid = nextPid;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Find the leaf where searchKey belongs and return its PageId in pid,
+ * along with the version of the leaf to validate a read of it against.
+ * The duplicates of a key may span several leaves. If first is true, the
+ * first leaf that can hold searchKey is found, otherwise the last one.
+ */
+RC BTreeIndex::findLeaf(int searchKey, bool first, PageId& pid, unsigned long long& version)
+{
+    // the tree height tells where the leaves are, so every node on the
+    // way down is read exactly once and decoded as the kind it is.
+    // a node read is only used once the node is known not to have been
+    // written since its version was taken. otherwise start over.
+    for (;; this_thread::yield()) {
+        unsigned long long meta, v;
+        unsigned long long generation = pinGeneration.load(memory_order_acquire);
+        if (!readLatch(metaLatch, meta)) {
+            continue;
+        }
+        pid = rootPid;
+        int height = treeHeight;
+        if (!readLatch(latchOf(pid), v) || !validate(metaLatch, meta)) {
+            continue;
+        }
+
+        // walk down the pinned levels through the child pointers of the
+        // pinned nodes, searching each in place, then go on with copies of
+        // the nodes below them. nothing is locked on the way: what is read
+        // from a pinned node is checked against its version like a copy.
+        RC error = 0;
+        PinnedNode* pinnedNode = pinnedLevels > 0 ? pinnedRoot.load(memory_order_acquire) : NULL;
+        for (int depth = 0; depth < height - 1 && error == 0; depth++) {
+            BTNonLeafNode copy;
+            BTNonLeafNode* node = &copy;
+            if (pinnedNode != NULL && pinnedNode->holds(pid)) {
+                node = &pinnedNode->node;
+            } else if ((error = readNonLeaf(pid, depth, copy, v, generation)) != 0) {
+                break;
+            }
+            int lo, hi;
+            node->locateChildRange(searchKey, lo, hi);
+            int child = first ? lo : hi;
+            PageId childPid = node->getChildPtr(child);
+            PinnedNode* childNode = NULL;
+            if (node != &copy && depth + 1 < height - 1) {
+                childNode = pinnedChild(*pinnedNode, child, depth + 1);
+            }
+
+            unsigned long long childVersion;
+            if (!readLatch(latchOf(childPid), childVersion) || !validate(latchOf(pid), v)) {
+                error = RC_RESTART;
+            } else {
+                pid = childPid;
+                v = childVersion;
+                pinnedNode = childNode;
+            }
+        }
+        if (error == 0) {
+            version = v;
+            return 0;
+        }
+        if (error != RC_RESTART && validate(latchOf(pid), v)) {
+            return error;
+        }
+    }
+}
+
+/*
+ * Find the leaf where searchKey belongs and read it. Return its PageId in pid
+ * and the version the leaf had when it was read in version.
+ */
+RC BTreeIndex::findAndReadLeaf(int searchKey, bool first, PageId& pid, BTLeafNode& leaf,
+                                unsigned long long& version)
+{
+    for (;; this_thread::yield()) {
+        RC error = findLeaf(searchKey, first, pid, version);
+        if (error != 0) {
+            return error;
+        }
+        error = leaf.read(pid, pf);
+        if (validate(latchOf(pid), version)) {
+            return error;
+        }
+    }
+}
+
+/*
+ * Read the leaf pid as it is between two writes of it, and return
+ * the version it had when it was read in version.
+ */
+RC BTreeIndex::readLeaf(PageId pid, BTLeafNode& leaf, unsigned long long& version)
+{
+    for (;; this_thread::yield()) {
+        if (readLatch(latchOf(pid), version)) {
+            RC error = leaf.read(pid, pf);
+            if (validate(latchOf(pid), version)) {
+                return error;
+            }
+        }
+    }
+}
+
+/*
+ * Count the index entries with keys in [lo, hi].
+ * @param lo[IN] the smallest key to count
+ * @param hi[IN] the largest key to count
+ * @param count[OUT] the number of entries with keys in [lo, hi]
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::countRange(int lo, int hi, int& count)
+{
+    count = 0;
+    if (lo > hi) {
+        return 0;
+    }
+
+    if (!entryCounts) {
+        IndexScan scan;
+        int keys[64];
+        RecordId rids[64];
+        int n;
+        RC error = openScan(lo, hi, scan);
+        while (error == 0 && (error = readScan(scan, keys, rids, 64, n)) == 0) {
+            count += n;
+        }
+        return error == RC_END_OF_TREE ? 0 : error;
+    }
+
+    // one path of nodes down to each end of the range
+    int below, upTo;
+    RC error = countBelow(lo, below);
+    if (error == 0) {
+        error = countBelow((long long) hi + 1, upTo);
+    }
+    if (error == 0) {
+        count = max(upTo - below, 0);  // writers may get in between the two
+    }
+    return error;
+}
+
+/*
+ * Count the index entries with keys smaller than key. key may be one
+ * above INT_MAX to count all entries.
+ */
+RC BTreeIndex::countBelow(long long key, int& count)
+{
+    // walk down as findLeaf() does, adding up the entry counts of the
+    // children in front of the one key is routed to
+    for (;; this_thread::yield()) {
+        unsigned long long meta, v;
+        unsigned long long generation = pinGeneration.load(memory_order_acquire);
+        if (!readLatch(metaLatch, meta)) {
+            continue;
+        }
+        PageId pid = rootPid;
+        int height = treeHeight;
+        if (!readLatch(latchOf(pid), v) || !validate(metaLatch, meta)) {
+            continue;
+        }
+
+        RC error = 0;
+        count = 0;
+        PinnedNode* pinnedNode = pinnedLevels > 0 ? pinnedRoot.load(memory_order_acquire) : NULL;
+        for (int depth = 0; depth < height - 1 && error == 0; depth++) {
+            BTNonLeafNode copy;
+            BTNonLeafNode* node = &copy;
+            if (pinnedNode != NULL && pinnedNode->holds(pid)) {
+                node = &pinnedNode->node;
+            } else if ((error = readNonLeaf(pid, depth, copy, v, generation)) != 0) {
+                break;
+            }
+
+            // the children in front of the first one that may hold key
+            // only hold smaller keys
+            int child = node->getKeyCount();
+            int last;
+            if (key <= INT_MAX) {
+                node->locateChildRange((int) key, child, last);
+            }
+            for (int i = 0; i < child; i++) {
+                count += node->getEntryCount(i);
+            }
+
+            PageId childPid = node->getChildPtr(child);
+            PinnedNode* childNode = NULL;
+            if (node != &copy && depth + 1 < height - 1) {
+                childNode = pinnedChild(*pinnedNode, child, depth + 1);
+            }
+            unsigned long long childVersion;
+            if (!readLatch(latchOf(childPid), childVersion) || !validate(latchOf(pid), v)) {
+                error = RC_RESTART;
+            } else {
+                pid = childPid;
+                v = childVersion;
+                pinnedNode = childNode;
+            }
+        }
+
+        if (error == 0) {
+            BTLeafNode leaf;
+            int eid = 0;
+            error = leaf.read(pid, pf);
+            if (error == 0) {
+                if (key <= INT_MAX) {
+                    leaf.locate((int) key, eid);
+                } else {
+                    eid = leaf.getKeyCount();
+                }
+                count += eid;
+            }
+            if (validate(latchOf(pid), v)) {
+                return error;
+            }
+        } else if (error != RC_RESTART && validate(latchOf(pid), v)) {
+            return error;
+        }
+    }
+}
+
+/*
+ * Start a scan over the index entries with keys in [lo, hi].
+ * @param lo[IN] the smallest key to return
+ * @param hi[IN] the largest key to return
+ * @param scan[OUT] the scan, positioned at the first entry with a key >= lo
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::openScan(int lo, int hi, IndexScan& scan)
+{
+    scan.lo = lo;
+    scan.hi = hi;
+    scan.descending = false;
+    scan.lastCount = 0;
+    scan.skip = 0;
+    if (lo > hi) {
+        scan.pid = -1;
+        return 0;
+    }
+    return seekScan(scan, lo);
+}
+
+/*
+ * Start a scan over the index entries with keys in [lo, hi]
+ * that returns them from the largest key down.
+ * @param lo[IN] the smallest key to return
+ * @param hi[IN] the largest key to return
+ * @param scan[OUT] the scan, positioned at the last entry with a key <= hi
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::openReverseScan(int lo, int hi, IndexScan& scan)
+{
+    scan.lo = lo;
+    scan.hi = hi;
+    scan.descending = true;
+    scan.lastCount = 0;
+    scan.skip = 0;
+    if (lo > hi) {
+        scan.pid = -1;
+        return 0;
+    }
+    return seekScan(scan, hi);
+}
+
+/*
+ * Position the scan at the first entry with a key >= key, or for a
+ * descending scan at the last entry with a key <= key.
+ */
+RC BTreeIndex::seekScan(IndexScan& scan, int key)
+{
+    scan.pid = -1;
+    PageId pid;
+    RC error = findAndReadLeaf(key, !scan.descending, pid, scan.leaf, scan.version);
+    if (error != 0) {
+        return error;
+    }
+    scan.pid = pid;
+    scan.leaf.locate(key, scan.eid);
+    if (scan.descending) {
+        // the leaf key is routed to is the last one that can hold key.
+        // start at its last entry with a key <= key.
+        int k;
+        RecordId rid;
+        while (scan.leaf.readEntry(scan.eid, k, rid) == 0 && k <= key) {
+            scan.eid++;
+        }
+        scan.eid--;
+    }
+    return 0;
+}
+
+/*
+ * Find the place a scan has got to again after the leaf it is in changed.
+ * The scan continues at the last key it returned, and skips the entries
+ * with that key it returned already. Those are still the first ones with
+ * the key: BTLeafNode::insert() puts a key behind its equal keys.
+ */
+RC BTreeIndex::resumeScan(IndexScan& scan)
+{
+    if (scan.lastCount == 0) {
+        return seekScan(scan, scan.descending ? scan.hi : scan.lo);
+    }
+    scan.skip = scan.lastCount;
+    return seekScan(scan, scan.lastKey);
+}
+
+/*
+ * Read the next entries of a scan in key order, up to max of them.
+ * @param scan[IN/OUT] the scan opened by openScan()
+ * @param keys[OUT] the keys read
+ * @param rids[OUT] the RecordIds read
+ * @param max[IN] the room in keys and rids
+ * @param n[OUT] the number of entries read
+ * @return 0 if n > 0. RC_END_OF_TREE when the scan is over.
+ */
+RC BTreeIndex::readScan(IndexScan& scan, int* keys, RecordId* rids, int max, int& n)
+{
+    return readScan(scan, keys, rids, NULL, max, n);
+}
+
+/*
+ * Read the next entries of a scan in key order, up to max of them,
+ * along with what they hold of the values of their tuples.
+ * @param scan[IN/OUT] the scan opened by openScan()
+ * @param keys[OUT] the keys read
+ * @param rids[OUT] the RecordIds read
+ * @param values[OUT] the value prefixes read, NULL if they are not needed
+ * @param max[IN] the room in keys, rids and values
+ * @param n[OUT] the number of entries read
+ * @return 0 if n > 0. RC_END_OF_TREE when the scan is over.
+ */
+RC BTreeIndex::readScan(IndexScan& scan, int* keys, RecordId* rids, IndexValue* values, int max, int& n)
+{
+    RC error;
+
+    n = 0;
+    while (n < max && scan.pid != -1) {
+        bool ended = scan.descending ? scan.eid < 0 : scan.eid >= scan.leaf.getKeyCount();
+        if (ended) {
+            // the sibling pointers of the copy of the leaf are only
+            // current if the leaf has not changed since it was read
+            if (!validate(latchOf(scan.pid), scan.version)) {
+                if ((error = resumeScan(scan)) != 0) {
+                    return error;
+                }
+                continue;
+            }
+
+            PageId pid = scan.pid;
+            unsigned long long version = scan.version;
+            scan.pid = scan.descending ? scan.leaf.getPrevNodePtr() : scan.leaf.getNextNodePtr();
+            if (scan.pid == -1) {
+                break;
+            }
+            if ((error = readLeaf(scan.pid, scan.leaf, scan.version)) != 0) {
+                scan.pid = -1;
+                return error;
+            }
+
+            // a remove may have moved entries between the two leaves
+            // meanwhile, so the one read is only in step with what was
+            // returned if the one left behind has still not changed
+            if (!validate(latchOf(pid), version)) {
+                if ((error = resumeScan(scan)) != 0) {
+                    return error;
+                }
+                continue;
+            }
+            if (!scan.descending) {
+                scan.eid = 0;
+            } else if (scan.leaf.getNextNodePtr() == pid) {
+                scan.eid = scan.leaf.getKeyCount() - 1;
+            } else {
+                // the previous leaf split after the leaf was read
+                if ((error = resumeScan(scan)) != 0) {
+                    return error;
+                }
+            }
+            continue;
+        }
+
+        scan.leaf.readEntry(scan.eid, keys[n], rids[n]);
+        if (values != NULL) {
+            scan.leaf.readValue(scan.eid, values[n]);
+        }
+        scan.eid += scan.descending ? -1 : 1;
+        if (scan.descending ? keys[n] < scan.lo : keys[n] > scan.hi) {
+            scan.pid = -1;
+            break;
+        }
+
+        // skip what was returned before the scan was resumed
+        if (scan.skip > 0 && keys[n] == scan.lastKey) {
+            scan.skip--;
+            continue;
+        }
+        scan.skip = 0;
+
+        if (scan.lastCount > 0 && keys[n] == scan.lastKey) {
+            scan.lastCount++;
+        } else {
+            scan.lastKey = keys[n];
+            scan.lastCount = 1;
+        }
+        n++;
+    }
+    return n > 0 ? 0 : RC_END_OF_TREE;
+}
+
+/*
+ * Read the (key, rid) pair at the location specified by the index cursor,
+ * and move foward the cursor to the next entry.
+ * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
+ * @param key[OUT] the key stored at the index cursor location.
+ * @param rid[OUT] the RecordId stored at the index cursor location.
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::readForward(IndexCursor& cursor, int& key, RecordId& rid)
+{
+    if (cursor.pid == -1) {
+        return RC_END_OF_TREE;
+    }
+    BTLeafNode leaf;
+    unsigned long long version;
+    RC leafRC = readLeaf(cursor.pid, leaf, version);
+    if (leafRC != 0) {
+        return leafRC;
+    }
+    leafRC = leaf.readEntry(cursor.eid, key, rid);
+    if (leafRC != 0) {
+        return leafRC;
+    }
+    leafRC = leaf.getNextCursor(cursor);
+    return leafRC;
+}
+
+/*
+ * Move the index cursor back to the previous entry and read the
+ * (key, rid) pair there.
+ * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
+ * @param key[OUT] the key stored in front of the index cursor location
+ * @param rid[OUT] the RecordId stored in front of the index cursor location
+ * @return error code. RC_END_OF_TREE if the cursor is at the first entry.
+ */
+RC BTreeIndex::readBackward(IndexCursor& cursor, int& key, RecordId& rid)
+{
+    BTLeafNode leaf;
+    unsigned long long version;
+    while (cursor.pid != -1) {
+        RC error = readLeaf(cursor.pid, leaf, version);
+        if (error != 0) {
+            return error;
+        }
+        if (cursor.eid > leaf.getKeyCount()) {
+            cursor.eid = leaf.getKeyCount();
+        }
+        if (cursor.eid > 0) {
+            cursor.eid--;
+            return leaf.readEntry(cursor.eid, key, rid);
+        }
+
+        // continue behind the last entry of the previous leaf
+        cursor.pid = leaf.getPrevNodePtr();
+        cursor.eid = INT_MAX;
+    }
+    return RC_END_OF_TREE;
+}
+
+/*
+ * Set how many levels of nonleaf nodes, counted from the root, are pinned in memory.
+ * @param levels[IN] the number of levels to pin. 0 pins nothing
+ */
+void BTreeIndex::setPinnedLevels(int levels)
+{
+    lock_guard<mutex> guard(pinMutex);
+    pinnedLevels = levels;
+    freePinned();
+}
+
+int BTreeIndex::getPinnedLevels() const
+{
+    return pinnedLevels;
+}
+
+size_t BTreeIndex::getPinnedBytes() const
+{
+    lock_guard<mutex> guard(pinMutex);
+    return pinnedNodes.size() * sizeof(PinnedNode);
+}
+
+BTreeIndex::PinnedNode::PinnedNode()
+{
+    pid = -1;
+    for (int i = 0; i <= MAX_KEYS; i++) {
+        children[i] = NULL;
+    }
+    unpinned = false;
+}
+
+/*
+ * Whether the two nonleaf nodes have the same child PageIds.
+ */
+static bool sameChildren(BTNonLeafNode& a, BTNonLeafNode& b)
+{
+    if (a.getKeyCount() != b.getKeyCount()) {
+        return false;
+    }
+    for (int i = 0; i <= a.getKeyCount(); i++) {
+        if (a.getChildPtr(i) != b.getChildPtr(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Read the nonleaf node pid at the given depth (the root is at depth 0),
+ * from its pinned copy if there is one. A node in the pinned levels
+ * is pinned when it is read from disk. The caller changes the tree, so
+ * no other writer changes the node while it is read.
+ */
+RC BTreeIndex::readNonLeaf(PageId pid, int depth, BTNonLeafNode& node)
+{
+    {
+        lock_guard<mutex> guard(pinMutex);
+        map<PageId, PinnedNode*>::const_iterator it = pinned.find(pid);
+        if (it != pinned.end()) {
+            node = it->second->node;
+            return 0;
+        }
+    }
+
+    RC error = node.read(pid, pf);
+    if (error == 0 && depth < pinnedLevels) {
+        lock_guard<mutex> guard(pinMutex);
+        if (pinned.find(pid) == pinned.end()) {
+            pin(pid, depth, node);
+        }
+    }
+    return error;
+}
+
+/*
+ * Read the nonleaf node pid at the given depth from disk for a reader
+ * that took version of its latch, and generation of the pinned nodes
+ * before it read rootPid. The reader only comes here for a node it did
+ * not reach through the pinned copies. The copy read is only pinned if
+ * the node was not written and no node was unpinned since: a writer may
+ * have written the page while it was read, or unpinned and freed it.
+ */
+RC BTreeIndex::readNonLeaf(PageId pid, int depth, BTNonLeafNode& node,
+                           unsigned long long version, unsigned long long generation)
+{
+    RC error = node.read(pid, pf);
+    if (error == 0 && depth < pinnedLevels && validate(latchOf(pid), version)) {
+        lock_guard<mutex> guard(pinMutex);
+        if (pinGeneration.load(memory_order_relaxed) == generation && validate(latchOf(pid), version) &&
+            pinned.find(pid) == pinned.end()) {
+            pin(pid, depth, node);
+        }
+    }
+    return error;
+}
+
+/*
+ * Write the nonleaf node pid at the given depth and refresh its pinned copy.
+ * The caller holds the latch of the node, so lookups reading the pinned
+ * copy in place start over.
+ */
+RC BTreeIndex::writeNonLeaf(PageId pid, int depth, BTNonLeafNode& node)
+{
+    RC error = node.write(pid, pf);
+    if (error == 0 && depth < pinnedLevels) {
+        // the child pointers only stay if they still belong to the same children
+        lock_guard<mutex> guard(pinMutex);
+        map<PageId, PinnedNode*>::iterator it = pinned.find(pid);
+        if (it == pinned.end()) {
+            pin(pid, depth, node);
+            return 0;
+        }
+        PinnedNode& pinnedNode = *it->second;
+        if (!sameChildren(pinnedNode.node, node)) {
+            for (int i = 0; i <= MAX_KEYS; i++) {
+                pinnedNode.children[i].store(NULL, memory_order_relaxed);
+            }
+        }
+        pinnedNode.node = node;
+    }
+    return error;
+}
+
+/*
+ * The pinned copy of the child the pinned node parent points to with its
+ * child-th pointer, or NULL if it is not pinned. The first lookup that
+ * passes finds it by PageId and sets the pointer, the others follow it.
+ */
+BTreeIndex::PinnedNode* BTreeIndex::pinnedChild(PinnedNode& parent, int child, int depth)
+{
+    PinnedNode* node = parent.children[child].load(memory_order_acquire);
+    if (node != NULL || depth >= pinnedLevels) {
+        return node;
+    }
+
+    lock_guard<mutex> guard(pinMutex);
+    if (parent.unpinned.load(memory_order_relaxed)) {
+        return NULL;
+    }
+    map<PageId, PinnedNode*>::const_iterator it = pinned.find(parent.node.getChildPtr(child));
+    if (it == pinned.end()) {
+        return NULL;
+    }
+    parent.children[child].store(it->second, memory_order_release);
+    return it->second;
+}
+
+/*
+ * Pin a copy of the node pid at the given depth. The caller holds pinMutex
+ * and knows that the node is not pinned yet.
+ */
+void BTreeIndex::pin(PageId pid, int depth, const BTNonLeafNode& node)
+{
+    pinnedNodes.emplace_back();
+    PinnedNode* pinnedNode = &pinnedNodes.back();
+    pinnedNode->pid = pid;
+    pinnedNode->node = node;
+    pinned[pid] = pinnedNode;
+    if (depth == 0) {
+        pinnedRoot.store(pinnedNode, memory_order_release);
+    }
+}
+
+/*
+ * Unpin the copy of the node pid, if there is one, and clear the pointers
+ * of the other pinned nodes to it.
+ */
+void BTreeIndex::unpin(PageId pid)
+{
+    lock_guard<mutex> guard(pinMutex);
+    pinGeneration.fetch_add(1, memory_order_relaxed);
+    map<PageId, PinnedNode*>::iterator gone = pinned.find(pid);
+    if (gone == pinned.end()) {
+        return;
+    }
+    PinnedNode* node = gone->second;
+    node->unpinned.store(true, memory_order_release);
+    for (map<PageId, PinnedNode*>::iterator it = pinned.begin(); it != pinned.end(); ++it) {
+        for (int i = 0; i <= MAX_KEYS; i++) {
+            if (it->second->children[i].load(memory_order_relaxed) == node) {
+                it->second->children[i].store(NULL, memory_order_relaxed);
+            }
+        }
+    }
+    if (pinnedRoot.load(memory_order_relaxed) == node) {
+        pinnedRoot.store(NULL, memory_order_relaxed);
+    }
+    pinned.erase(gone);
+}
+
+/*
+ * Unpin every node, while lookups may be running, as when the root changes.
+ */
+void BTreeIndex::unpinAll()
+{
+    lock_guard<mutex> guard(pinMutex);
+    pinGeneration.fetch_add(1, memory_order_relaxed);
+    for (map<PageId, PinnedNode*>::iterator it = pinned.begin(); it != pinned.end(); ++it) {
+        it->second->unpinned.store(true, memory_order_release);
+    }
+    pinned.clear();
+    pinnedRoot.store(NULL, memory_order_relaxed);
+}
+
+/*
+ * Drop all the pinned and unpinned copies. Only called when nothing else
+ * uses the index.
+ */
+void BTreeIndex::freePinned()
+{
+    pinnedRoot = NULL;
+    pinned.clear();
+    pinnedNodes.clear();
+}
+
+/*
+ * The latch of a node. The nodes share LATCH_STRIPES latches by PageId.
+ */
+BTreeIndex::Latch& BTreeIndex::latchOf(PageId pid)
+{
+    return nodeLatches[(unsigned int) pid % LATCH_STRIPES];
+}
+
+/*
+ * Latch the node pid for writing and add it to held, unless held has its latch already.
+ */
+void BTreeIndex::holdLatch(PageId pid, vector<LatchHold>& held)
+{
+    Latch* latch = &latchOf(pid);
+    for (unsigned i = 0; i < held.size(); i++) {
+        if (held[i].latch == latch) {
+            return;
+        }
+    }
+    LatchHold hold;
+    hold.latch = latch;
+    hold.version = writeLatch(*latch);
+    held.push_back(hold);
+}
+
+/*
+ * Release the latches in held but the one of the node keep.
+ * The nodes they cover have not been written, so their versions are
+ * put back as they were and no reader has to start over.
+ */
+void BTreeIndex::releaseUnchanged(vector<LatchHold>& held, PageId keep)
+{
+    Latch* kept = &latchOf(keep);
+    vector<LatchHold> left;
+    for (unsigned i = 0; i < held.size(); i++) {
+        if (held[i].latch == kept) {
+            left.push_back(held[i]);
+        } else {
+            held[i].latch->store(held[i].version, memory_order_release);
+        }
+    }
+    held.swap(left);
+}
+
+/*
+ * Release all latches in held, marking the nodes they cover as written.
+ */
+void BTreeIndex::releaseLatches(vector<LatchHold>& held)
+{
+    for (unsigned i = 0; i < held.size(); i++) {
+        unlatch(*held[i].latch);
+    }
+    held.clear();
 }
@@ -10,20 +10,77 @@
 #ifndef BTREEINDEX_H
 #define BTREEINDEX_H
 
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
 #include "BTreeNode.h"
 #include "Bruinbase.h"
 #include "PageFile.h"
 #include "RecordFile.h"
 
+// the bit of TreeIndexMetadata.flags that is set
+// if the nonleaf nodes keep entry counts
+const int INDEX_ENTRY_COUNTS = 1;
+
 typedef struct {
     PageId rootPid;
     int treeHeight;
-    int flags[1016];
+    PageId freePid;   // the first page on the list of free pages, -1 if none
+    int valuePrefix;  // the length of the value prefixes in the leaves, 0 if none
+    int flags;        // INDEX_ENTRY_COUNTS if the nonleaf nodes keep entry counts
+    int unused[1013];
 } TreeIndexMetadata;
 
+/**
+ * The state of a range scan over the leaves of a BTreeIndex.
+ * The scan keeps the leaf it is in decoded in memory, so each leaf
+ * is read from disk once however many entries are returned from it.
+ */
+struct IndexScan {
+    BTLeafNode leaf;  /// the leaf the scan is in
+    PageId     pid;   /// the PageId of leaf. -1 once the scan is done
+    int        eid;   /// the entry of leaf to return next
+    int        lo;    /// the smallest key the scan returns
+    int        hi;    /// the largest key the scan returns
+    bool       descending; /// whether the scan runs from hi down to lo
+    unsigned long long version; /// the version of leaf when it was read
+    int        lastKey;   /// the last key returned
+    int        lastCount; /// # entries with lastKey returned, 0 if none
+    int        skip;      /// # entries with lastKey to pass over
+};
+
 /**
  * Implements a B-Tree index for bruinbase.
- * 
+ *
+ * An index made with setEntryCounts(true) keeps in every nonleaf entry the
+ * number of leaf entries under its child, so countRange() reads two paths
+ * of nodes however many keys it counts. The counts take room from the keys
+ * and make every insert and remove change its whole path, so they are off
+ * by default.
+ *
+ * insert(), remove(), locate(), locateBatch(), countRange(), the scans and
+ * the cursor reads may be called from several threads at the same time.
+ * Readers do not lock the nodes: they read a node, check that its version
+ * did not change meanwhile and start over from the root if it did. A
+ * lookup that finds its nodes pinned and its leaf in the PageFile cache
+ * takes no lock at all. One that reads a page from disk takes the cache
+ * lock to cache it, and one that pins a node, or is the first to follow
+ * a pointer between two pinned nodes, takes the lock of the pinned
+ * nodes for that step. An insert or remove that only changes its leaf
+ * latches nothing but the leaf. Those that change nonleaf nodes, and all
+ * of them with entry counts, run one at a time and latch the nodes on
+ * their path. open(), close(), the bulk load
+ * and setPinnedLevels() must not run alongside anything else.
+ *
+ * Writes are cheapest in key order: insertBatch() puts the pairs that go
+ * to one leaf in with one pass down the tree.
+ * A key beyond the end of the full last leaf starts a new leaf instead of
+ * splitting the old one in half, so an index that grows at its end keeps
+ * its nodes full rather than half empty. Such an index also remembers
+ * its last leaf, so that an insert of a key that goes there reads the
+ * leaf without going down the tree.
  */
 class BTreeIndex {
  public:
@@ -52,8 +109,103 @@ class BTreeIndex {
    */
   RC insert(int key, const RecordId& rid);
 
-  RC indexInsert(BTNonLeafNode& index, PageId pid, int key, const RecordId& rid, BTNonLeafNode& sibling, int& midKey);
-  RC leafInsert(BTLeafNode& leaf, int key, const RecordId& rid, BTLeafNode& sibling, int& siblingKey);
+  /**
+   * Insert (key, RecordId) pair to the index, along with the value of
+   * the tuple. A covering index keeps a prefix of the value in the leaf
+   * entry, see setValuePrefix(). Other indexes ignore the value.
+   * @param key[IN] the key for the value inserted into the index
+   * @param rid[IN] the RecordId for the record being inserted into the index
+   * @param value[IN] the value of the tuple, NULL if it is not known
+   * @return error code. 0 if no error
+   */
+  RC insert(int key, const RecordId& rid, const char* value);
+
+  /**
+   * Insert a batch of (key, RecordId) pairs given in key order. The pairs
+   * that go to the same leaf are put in with a single read and write of
+   * the leaf and of the nodes above it, instead of one for every pair.
+   * @param keys[IN] the keys, in ascending order
+   * @param rids[IN] the RecordIds for the records with the keys
+   * @param values[IN] the values of the tuples, NULL if they are not known
+   * @param n[IN] the number of pairs
+   * @return error code. RC_UNSORTED_INPUT if the keys are not in order
+   */
+  RC insertBatch(const int* keys, const RecordId* rids, const char* const* values, int n);
+
+  /**
+   * Make the index a covering index, whose leaf entries keep the first
+   * length characters of the value of their tuple, or the whole value
+   * if it is not longer. Queries can then check value conditions and
+   * return short values without reading the table.
+   * The index must be empty.
+   * @param length[IN] the prefix length, between 0 (none) and MAX_VALUE_PREFIX
+   * @return error code. 0 if no error
+   */
+  RC setValuePrefix(int length);
+
+  /**
+   * @return the length of the value prefixes the leaves keep, 0 if none
+   */
+  int getValuePrefix() const;
+
+  /**
+   * Make the nonleaf nodes keep the number of leaf entries under each
+   * child, for countRange(). Without them, countRange() reads the leaves
+   * in the range. The index must be empty.
+   * @param on[IN] whether to keep entry counts
+   * @return error code. 0 if no error
+   */
+  RC setEntryCounts(bool on);
+
+  /**
+   * @return whether the nonleaf nodes keep entry counts
+   */
+  bool hasEntryCounts() const;
+
+  /**
+   * Remove the (key, RecordId) pair from the index.
+   * A leaf left less than half full takes entries from a sibling, or is
+   * merged into it if the entries of both fit in one page. The page of
+   * a merged node goes on a free list and is used again by later splits.
+   * Nonleaf nodes are treated the same way up to the root, and a root
+   * left with a single child is replaced by the child.
+   * @param key[IN] the key of the pair to remove
+   * @param rid[IN] the RecordId of the pair to remove
+   * @return error code. RC_NO_SUCH_RECORD if the pair is not in the index
+   */
+  RC remove(int key, const RecordId& rid);
+
+  /**
+   * Start building the index bottom-up from (key, RecordId) pairs that
+   * are given in key order through bulkLoadAppend(). The index must be
+   * empty, i.e., freshly created in 'w' mode.
+   * Leaves are filled up to fillFactor and written to consecutive pages,
+   * and bulkLoadEnd() then builds each level of nonleaf nodes from the
+   * level below it. This writes every page exactly once.
+   * @param fillFactor[IN] how full to make each node, between 0 and 1
+   * @return error code. 0 if no error
+   */
+  RC bulkLoadBegin(double fillFactor);
+
+  /**
+   * Append the next (key, RecordId) pair of a bulk load.
+   * @param key[IN] the key. It must not be smaller than the previous key.
+   * @param rid[IN] the RecordId for the record with the key
+   * @return error code. 0 if no error
+   */
+  RC bulkLoadAppend(int key, const RecordId& rid);
+
+  /**
+   * Append the next (key, RecordId) pair of a bulk load, along with the
+   * value of the tuple for a covering index.
+   */
+  RC bulkLoadAppend(int key, const RecordId& rid, const char* value);
+
+  /**
+   * Finish a bulk load: write the last leaf and build the nonleaf levels.
+   * @return error code. 0 if no error
+   */
+  RC bulkLoadEnd();
 
   /**
    * Run the standard B+Tree key search algorithm and identify the
@@ -74,7 +226,20 @@ class BTreeIndex {
    * @return 0 if searchKey is found. Othewise, an error code
    */
   RC locate(int searchKey, IndexCursor& cursor);
-  RC locateFull(int searchKey, IndexCursor& cursor, PageId curPid);
+
+  /**
+   * Run locate() for a batch of keys at once. The keys are sorted and the
+   * tree is walked once for the whole batch: every node on the way is
+   * read once and each of its children is visited with just the keys
+   * routed to it, so the nodes the keys share are not read once per key.
+   * @param searchKeys[IN] the keys to find, in any order
+   * @param n[IN] the number of keys
+   * @param cursors[OUT] cursors[i] is set as locate() sets it for searchKeys[i]
+   * @param results[OUT] results[i] is 0 if searchKeys[i] is found,
+   *                     RC_NO_SUCH_RECORD if not
+   * @return error code. 0 if no error
+   */
+  RC locateBatch(const int* searchKeys, int n, IndexCursor* cursors, RC* results);
 
   /**
    * Read the (key, rid) pair at the location specified by the index cursor,
@@ -85,16 +250,221 @@ class BTreeIndex {
    * @return error code. 0 if no error
    */
   RC readForward(IndexCursor& cursor, int& key, RecordId& rid);
-  
+
+  /**
+   * Move the index cursor back to the previous entry and read the
+   * (key, rid) pair there. A cursor set by locate(searchKey) thus reads
+   * the entries with keys smaller than searchKey from the largest down.
+   * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
+   * @param key[OUT] the key stored in front of the index cursor location
+   * @param rid[OUT] the RecordId stored in front of the index cursor location
+   * @return error code. RC_END_OF_TREE if the cursor is at the first entry.
+   */
+  RC readBackward(IndexCursor& cursor, int& key, RecordId& rid);
+
+  /**
+   * Start a scan over the index entries with keys in [lo, hi].
+   * @param lo[IN] the smallest key to return
+   * @param hi[IN] the largest key to return
+   * @param scan[OUT] the scan, positioned at the first entry with a key >= lo
+   * @return error code. 0 if no error
+   */
+  RC openScan(int lo, int hi, IndexScan& scan);
+
+  /**
+   * Start a scan over the index entries with keys in [lo, hi] that
+   * returns them in descending key order. The scan starts at hi and
+   * walks the leaves backwards through their prevLeaf pointers, so
+   * a query bounded from above reads no leaf below what it returns.
+   * @param lo[IN] the smallest key to return
+   * @param hi[IN] the largest key to return
+   * @param scan[OUT] the scan, positioned at the last entry with a key <= hi
+   * @return error code. 0 if no error
+   */
+  RC openReverseScan(int lo, int hi, IndexScan& scan);
+
+  /**
+   * Count the index entries with keys in [lo, hi]. With entry counts, this
+   * is done from the counts of the nonleaf nodes, without reading the
+   * leaves in between. Otherwise the entries are scanned.
+   * @param lo[IN] the smallest key to count
+   * @param hi[IN] the largest key to count
+   * @param count[OUT] the number of entries with keys in [lo, hi]
+   * @return error code. 0 if no error
+   */
+  RC countRange(int lo, int hi, int& count);
+
+  /**
+   * Read the next entries of a scan, up to max of them.
+   * An ascending scan moves to the next leaf through its nextLeaf pointer
+   * when the current one runs out and ends at the first key above hi.
+   * A descending scan follows prevLeaf and ends at the first key below lo.
+   * @param scan[IN/OUT] the scan opened by openScan()
+   * @param keys[OUT] the keys read
+   * @param rids[OUT] the RecordIds read
+   * @param max[IN] the room in keys and rids
+   * @param n[OUT] the number of entries read
+   * @return 0 if n > 0. RC_END_OF_TREE when the scan is over.
+   */
+  RC readScan(IndexScan& scan, int* keys, RecordId* rids, int max, int& n);
+
+  /**
+   * Like readScan(scan, keys, rids, max, n), and also return what the
+   * entries hold of the values of their tuples.
+   * @param values[OUT] the value prefixes read, see IndexValue
+   */
+  RC readScan(IndexScan& scan, int* keys, RecordId* rids, IndexValue* values, int max, int& n);
+
+  /**
+   * Set how many levels of nonleaf nodes, counted from the root, are
+   * pinned in memory. A pinned node is read from disk once and then
+   * served from its in-memory copy, which is refreshed whenever the
+   * index writes the node. With the root and the level below it pinned,
+   * a lookup in a 3-level tree reads a single page: its leaf.
+   * The index keeps a pointer to the pinned root, and a pinned node
+   * points straight at the pinned copies of its children, so the lookups
+   * walk down the pinned levels by following pointers, without looking
+   * the nodes up by PageId, copying them or taking a lock.
+   * With all nonleaf levels pinned, only the leaf is read.
+   * Nothing is evicted: the levels bound what is pinned. A node that is
+   * freed, and every node when the root changes, is unpinned, but its
+   * copy is only freed by close() and setPinnedLevels(), as lookups may
+   * still be reading it. Inserts unpin only when the tree grows a level;
+   * removes also unpin each pinned node they merge away.
+   * Pinned copies are only kept coherent with writes made through this
+   * BTreeIndex object.
+   * @param levels[IN] the number of levels to pin. 0 pins nothing
+   */
+  void setPinnedLevels(int levels);
+
+  /**
+   * @return the number of levels pinned in memory
+   */
+  int getPinnedLevels() const;
+
+  /**
+   * @return the memory taken by the pinned and the unpinned copies, in bytes
+   */
+  size_t getPinnedBytes() const;
+
+  static const int DEFAULT_PINNED_LEVELS = 2;
+
  private:
+  typedef std::atomic<unsigned long long> Latch;
+
+  struct LatchHold {
+    Latch* latch;                /// a latch held for writing
+    unsigned long long version;  /// its version before it was taken
+  };
+
+  RC findLeaf(int searchKey, bool first, PageId& pid, unsigned long long& version);
+  RC findAndReadLeaf(int searchKey, bool first, PageId& pid, BTLeafNode& leaf, unsigned long long& version);
+  RC readLeaf(PageId pid, BTLeafNode& leaf, unsigned long long& version);
+  bool readLastLeaf(int key, PageId& pid, BTLeafNode& leaf, unsigned long long& version);
+  struct PinnedNode;
+
+  RC locateBatchIn(PageId pid, unsigned long long version, unsigned long long generation,
+                   PinnedNode* pinnedNode, int depth, int height, const int* searchKeys, const int* order, int n,
+                   IndexCursor* cursors, RC* results);
+  RC seekScan(IndexScan& scan, int key);
+  RC resumeScan(IndexScan& scan);
+  RC countBelow(long long key, int& count);
+  RC insertOne(int key, const RecordId& rid, const char* value);
+  RC insertRunInto(PageId pid, int depth, const int* keys, const RecordId* rids,
+                   const char* const* values, int n, long long bound,
+                   int& done, int& count, std::vector<LatchHold>& held);
+  RC insertSorted(const int* keys, const RecordId* rids, const char* const* values, int n);
+  RC insertInto(PageId pid, int depth, bool last, int key, const RecordId& rid, const char* value,
+                int& count, int& splitKey, PageId& splitPid, int& splitCount,
+                std::vector<LatchHold>& held);
+  RC removeFrom(PageId pid, int depth, bool only, int key, const RecordId& rid, int& count,
+                std::vector<LatchHold>& held);
+  RC fixUnderflow(BTNonLeafNode& node, int child, int depth, std::vector<LatchHold>& held);
+  RC allocatePage(PageId& pid);
+  RC freePage(PageId pid);
+  Latch& latchOf(PageId pid);
+  void holdLatch(PageId pid, std::vector<LatchHold>& held);
+  void releaseUnchanged(std::vector<LatchHold>& held, PageId keep);
+  void releaseLatches(std::vector<LatchHold>& held);
+  RC readNonLeaf(PageId pid, int depth, BTNonLeafNode& node);
+  RC readNonLeaf(PageId pid, int depth, BTNonLeafNode& node,
+                 unsigned long long version, unsigned long long generation);
+  RC writeNonLeaf(PageId pid, int depth, BTNonLeafNode& node);
+  PinnedNode* pinnedChild(PinnedNode& parent, int child, int depth);
+  void pin(PageId pid, int depth, const BTNonLeafNode& node);
+  void unpin(PageId pid);
+  void unpinAll();
+  void freePinned();
+
   PageFile pf;         /// the PageFile used to store the actual b+tree in disk
 
-  PageId   rootPid;    /// the PageId of the root node
-  int      treeHeight; /// the height of the tree
-  /// Note that the content of the above two variables will be gone when
-  /// this class is destructed. Make sure to store the values of the two 
-  /// variables in disk, so that they can be reconstructed when the index
+  std::atomic<PageId> rootPid;    /// the PageId of the root node
+  std::atomic<int>    treeHeight; /// the height of the tree. the nodes at depth
+                                  /// treeHeight - 1 are leaves, all others nonleaf
+  PageId              freePid;    /// the first free page, -1 if none
+  int                 valuePrefix; /// the length of the value prefixes
+                                   /// in the leaves, 0 if none
+  bool                entryCounts; /// whether the nonleaf nodes keep
+                                   /// entry counts
+  /// Note that the content of the above variables will be gone when
+  /// this class is destructed. Make sure to store their values
+  /// in disk, so that they can be reconstructed when the index
   /// is opened again later.
+
+  std::atomic<PageId> lastLeafPid; /// the last leaf an insert saw, -1 if none
+
+  /**
+   * A pinned nonleaf node. children[i] points to the pinned copy of the
+   * child node.getChildPtr(i), or is NULL if it is not pinned or has not
+   * been looked up yet. The pointers are set as lookups pass by, cleared
+   * when the child PageIds of the node change and when a child is unpinned.
+   * An unpinned copy stays in memory, marked unpinned, as lookups that
+   * got to it before may still be reading it.
+   */
+  struct PinnedNode {
+    PageId                   pid;
+    BTNonLeafNode            node;
+    std::atomic<PinnedNode*> children[MAX_KEYS + 1];
+    std::atomic<bool>        unpinned;
+
+    PinnedNode();
+
+    /**
+     * @return whether this is the pinned copy of the node pid
+     */
+    bool holds(PageId p) const { return pid == p && !unpinned.load(std::memory_order_acquire); }
+  };
+
+  int pinnedLevels;                    /// # levels of nodes to pin
+  std::list<PinnedNode> pinnedNodes;   /// the pinned and unpinned copies
+  std::map<PageId, PinnedNode*> pinned; /// the pinned copies by PageId
+  std::atomic<PinnedNode*> pinnedRoot; /// the pinned copy of the root, or NULL
+  mutable std::mutex pinMutex;         /// guards the above, the children
+                                       /// pointers being set and the writes
+                                       /// to the pinned copies
+  std::atomic<unsigned long long> pinGeneration; /// bumped whenever nodes
+                                       /// are unpinned while readers run
+
+  static const int LATCH_STRIPES = 1024;
+  Latch nodeLatches[LATCH_STRIPES]; /// the latches of the nodes, by PageId
+  Latch metaLatch;                  /// the latch of rootPid and treeHeight
+  std::mutex writeMutex;            /// lets one insert or remove at a time
+                                    /// change the tree
+
+  //
+  // the state of a bulk load in progress
+  //
+  double     bulkFill;      /// the fill factor of the bulk load
+  BTLeafNode bulkLeaf;      /// the leaf being filled
+  PageId     bulkLeafPid;   /// the page the leaf being filled goes to
+  int        bulkLastKey;   /// the last key appended
+  struct BulkNode {
+    int    key;    /// the first key in the node
+    PageId pid;    /// the page of the node
+    int    count;  /// the number of entries in its subtree
+  };
+  std::vector<BulkNode> bulkLevel; /// the nodes of the level
+                                   /// written so far
 };
 
 #endif /* BTREEINDEX_H */
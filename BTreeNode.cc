@@ -1,14 +1,214 @@
 #include <cstring>
 #include "BTreeNode.h"
+#include "KeySearch.h"
 
 using namespace std;
 
+static_assert(RecordFile::RECORDS_PER_PAGE <= (1 << SID_BITS),
+              "a sid must fit in SID_BITS bits");
+static_assert(sizeof(BTLeafNodeBuffer) == PageFile::PAGE_SIZE &&
+              sizeof(BTNonLeafNodeBuffer) == PageFile::PAGE_SIZE &&
+              sizeof(BTCountedNodeBuffer) == PageFile::PAGE_SIZE,
+              "a node must take exactly one page");
+static_assert(MAX_VALUE_PREFIX < VALUE_SLOT_TRUNCATED,
+              "a value slot must tell a value length from a truncated value");
 
+// the largest error of the key interpolation model of a leaf for which
+// locate() uses the model. searching the 2 * error + 2 keys around the
+// predicted position then takes fewer probes than searching the leaf.
+static const int LEAF_MODEL_MAX_ERROR = 16;
+
+/*
+ * Return the number of bits needed to store any value in [0, range].
+ */
+static int bitsFor(unsigned int range) {
+    return range == 0 ? 0 : 32 - __builtin_clz(range);
+}
+
+/*
+ * Return the number of bytes n packed values of the given width take.
+ */
+static int packedSize(int n, int bits) {
+    return (n * bits + 7) / 8;
+}
+
+/*
+ * Pack values[0..n) with bits bits each into out, lowest bit first.
+ * out must be zeroed and have 8 bytes of slack behind the packed values.
+ */
+static void packBits(unsigned char* out, const unsigned long long* values, int n, int bits) {
+    for (int i = 0; i < n; i++) {
+        int pos = i * bits;
+        unsigned long long word;
+        memcpy(&word, out + (pos >> 3), sizeof(word));
+        word |= values[i] << (pos & 7);
+        memcpy(out + (pos >> 3), &word, sizeof(word));
+    }
+}
+
+/*
+ * Unpack n values of bits bits each from in. Every value is decoded with
+ * one unaligned load, a shift and a mask, independently of the others,
+ * so the loop has no branches and the compiler can vectorize it.
+ * in must be readable for 8 bytes behind the packed values.
+ */
+static void unpackBits(const unsigned char* in, unsigned long long* values, int n, int bits) {
+    unsigned long long mask = (1ULL << bits) - 1;
+    for (int i = 0; i < n; i++) {
+        int pos = i * bits;
+        unsigned long long word;
+        memcpy(&word, in + (pos >> 3), sizeof(word));
+        values[i] = (word >> (pos & 7)) & mask;
+    }
+}
+
+/*
+ * The packing of the entries of a leaf page, see BTLeafPageHeader.
+ */
+struct LeafEncoding {
+    int keyBits;
+    int pidBits;
+    PageId basePid;
+    int runCount;   // the number of posting lists, 0 if every entry keeps its key
+    int runBits;
+};
+
+/*
+ * Return the number of data bytes the keys of n entries take: runCount
+ * keys and run lengths for posting lists, n keys otherwise.
+ */
+static int keysSize(int n, int keyBits, int runCount, int runBits) {
+    return runCount > 0 ? packedSize(runCount, keyBits) + packedSize(runCount, runBits)
+                        : packedSize(n, keyBits);
+}
+
+/*
+ * Compute the packing of the entries (keys[i], rids[i]) for i in [0, n)
+ * and return the number of data bytes they take in a leaf page, along with
+ * their value slots of valueSlot bytes each. keys must be sorted. The keys
+ * are stored as posting lists when that takes fewer bytes.
+ */
+static int leafEncoding(const int* keys, const RecordId* rids, int n, int valueSlot,
+                        LeafEncoding& enc) {
+    enc.keyBits = enc.pidBits = enc.runCount = enc.runBits = 0;
+    enc.basePid = 0;
+    if (n == 0) {
+        return 0;
+    }
+    PageId minPid = rids[0].pid;
+    PageId maxPid = rids[0].pid;
+    int runs = 1;
+    int run = 1;
+    int longestRun = 1;
+    for (int i = 1; i < n; i++) {
+        minPid = rids[i].pid < minPid ? rids[i].pid : minPid;
+        maxPid = rids[i].pid > maxPid ? rids[i].pid : maxPid;
+        if (keys[i] != keys[i - 1]) {
+            runs++;
+            run = 0;
+        }
+        run++;
+        longestRun = run > longestRun ? run : longestRun;
+    }
+    enc.keyBits = bitsFor((unsigned int) keys[n - 1] - (unsigned int) keys[0]);
+    enc.pidBits = bitsFor((unsigned int) maxPid - (unsigned int) minPid);
+    enc.basePid = minPid;
+    if (keysSize(n, enc.keyBits, runs, bitsFor(longestRun - 1)) < packedSize(n, enc.keyBits)) {
+        enc.runCount = runs;
+        enc.runBits = bitsFor(longestRun - 1);
+    }
+    return keysSize(n, enc.keyBits, enc.runCount, enc.runBits) +
+           packedSize(n, enc.pidBits + SID_BITS) + n * valueSlot;
+}
+
+/*
+ * Check whether the entries (keys[i], rids[i]) for i in [0, n) fit in one leaf page.
+ */
+static bool leafFits(const int* keys, const RecordId* rids, int n, int valueSlot) {
+    LeafEncoding enc;
+    return n <= MAX_KEY_RECORDS && leafEncoding(keys, rids, n, valueSlot, enc) <= LEAF_DATA_SIZE;
+}
+
+/*
+ * Fill the value slot of valuePrefix + 1 bytes of an entry with value.
+ */
+static void encodeValue(unsigned char* slot, int valuePrefix, const char* value) {
+    memset(slot, 0, valuePrefix + 1);
+    if (value == NULL) {
+        slot[0] = VALUE_SLOT_UNKNOWN;
+        return;
+    }
+    int length = strnlen(value, valuePrefix + 1);
+    slot[0] = length > valuePrefix ? VALUE_SLOT_TRUNCATED : length;
+    memcpy(slot + 1, value, length > valuePrefix ? valuePrefix : length);
+}
+
+/*
+ * Read the page pid from the PageFile pf.
+ * @param pid[IN] the PageId to read
+ * @param pf[IN] PageFile to read from
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNodePage::read(PageId pid, const PageFile& pf) {
+    return pf.read(pid, (void *) buffer);
+}
+
+int BTNodePage::getType() const {
+    BTNodeHeader header;
+    memcpy(&header, buffer, sizeof(header));
+    return header.type;
+}
+
+const char* BTNodePage::getBytes() const {
+    return (const char *) buffer;
+}
+
+/*
+ * Find where to split the entries (keys[i], rids[i]) for i in [0, n) into
+ * two leaves, with value slots of valueSlot bytes. Prefer the boundary
+ * between two runs of duplicate keys closest to the middle, within a
+ * quarter of the entries of it, so that the entries of a key stay in one
+ * leaf. Otherwise start in the middle and move away from it until both
+ * halves fit in a page. Return -1 if there is no such point.
+ */
+static int leafSplitPoint(const int* keys, const RecordId* rids, int n, int valueSlot) {
+    for (int d = 0; d <= n / 4; d++) {
+        int candidates[2] = { n / 2 - d, n / 2 + d };
+        for (int c = 0; c < 2; c++) {
+            int at = candidates[c];
+            if (at > 0 && at < n && keys[at - 1] != keys[at] &&
+                leafFits(keys, rids, at, valueSlot) &&
+                leafFits(keys + at, rids + at, n - at, valueSlot)) {
+                return at;
+            }
+        }
+    }
+    for (int d = 0; d <= n / 2; d++) {
+        int candidates[2] = { n / 2 - d, n / 2 + d };
+        for (int c = 0; c < 2; c++) {
+            int at = candidates[c];
+            if (at > 0 && at < n && leafFits(keys, rids, at, valueSlot) &&
+                leafFits(keys + at, rids + at, n - at, valueSlot)) {
+                return at;
+            }
+        }
+    }
+    return -1;
+}
 
 BTLeafNode::BTLeafNode() {
-    buffer.numKeyRecords = 0;
-    buffer.nextLeaf = -1;
-    buffer.flags[0] = IS_LEAF;
+    numKeyRecords = 0;
+    nextLeaf = -1;
+    prevLeaf = -1;
+    valuePrefix = 0;
+    modelError = -1;
+}
+
+/*
+ * Return the size of the value slot of an entry, 0 if the node keeps no values.
+ */
+int BTLeafNode::valueSlot() const {
+    return valuePrefix > 0 ? valuePrefix + 1 : 0;
 }
 
 /*
@@ -18,13 +218,77 @@ BTLeafNode::BTLeafNode() {
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTLeafNode::read(PageId pid, const PageFile& pf) {
-    RC pfRC = pf.read(pid, (void *) &buffer);
+    BTNodePage page;
+    RC pfRC = page.read(pid, pf);
     if (pfRC != 0) {
         return pfRC;
     }
-    if (buffer.flags[0] != IS_LEAF) {
+    return read(page);
+}
+
+/*
+ * Decode the content of the node from a page that was already read.
+ * @param page[IN] the page holding the node
+ * @return 0 if successful. RC_INVALID_ATTRIBUTE if the page holds
+ *         a different kind of node.
+ */
+RC BTLeafNode::read(const BTNodePage& page) {
+    if (page.getType() != IS_LEAF) {
         return RC_INVALID_ATTRIBUTE;
     }
+
+    const BTLeafNodeBuffer& buffer = *(const BTLeafNodeBuffer *) page.getBytes();
+    const BTLeafPageHeader& header = buffer.header;
+    numKeyRecords = header.node.count;
+    nextLeaf = header.nextLeaf;
+    prevLeaf = header.prevLeaf;
+    valuePrefix = header.valuePrefix;
+    modelError = header.modelError - 1;
+    int runCount = header.runCount;
+    int keyBytes = keysSize(numKeyRecords, header.keyBits, runCount, header.runBits);
+    if (numKeyRecords < 0 || numKeyRecords > MAX_KEY_RECORDS || runCount > numKeyRecords ||
+        header.keyBits > 32 || header.pidBits > 32 || header.runBits > 32 ||
+        valuePrefix > MAX_VALUE_PREFIX ||
+        keyBytes + packedSize(numKeyRecords, header.pidBits + SID_BITS) +
+        numKeyRecords * valueSlot() > LEAF_DATA_SIZE) {
+        return RC_INVALID_FILE_FORMAT;
+    }
+
+    // the packed values may be read up to 8 bytes past the packed data,
+    // which stays inside the slack behind the page
+    unsigned long long values[MAX_KEY_RECORDS];
+    if (runCount == 0) {
+        unpackBits(buffer.data, values, numKeyRecords, header.keyBits);
+        for (int i = 0; i < numKeyRecords; i++) {
+            keys[i] = (int) ((unsigned int) header.baseKey + (unsigned int) values[i]);
+        }
+    } else {
+        // every posting list repeats its key for the length of its run
+        unsigned long long runs[MAX_KEY_RECORDS];
+        unpackBits(buffer.data, values, runCount, header.keyBits);
+        unpackBits(buffer.data + packedSize(runCount, header.keyBits), runs, runCount, header.runBits);
+        int n = 0;
+        for (int r = 0; r < runCount; r++) {
+            int key = (int) ((unsigned int) header.baseKey + (unsigned int) values[r]);
+            if (runs[r] >= (unsigned long long) (numKeyRecords - n)) {
+                return RC_INVALID_FILE_FORMAT;
+            }
+            for (int end = n + (int) runs[r] + 1; n < end; n++) {
+                keys[n] = key;
+            }
+        }
+        if (n != numKeyRecords) {
+            return RC_INVALID_FILE_FORMAT;
+        }
+    }
+    int ridBits = header.pidBits + SID_BITS;
+    unpackBits(buffer.data + keyBytes, values, numKeyRecords, ridBits);
+    for (int i = 0; i < numKeyRecords; i++) {
+        rids[i].pid = header.basePid + (PageId) (values[i] >> SID_BITS);
+        rids[i].sid = (int) (values[i] & ((1 << SID_BITS) - 1));
+    }
+    memcpy(this->values, buffer.data + keyBytes + packedSize(numKeyRecords, ridBits),
+           numKeyRecords * valueSlot());
     return 0;
 }
     
@@ -35,6 +299,63 @@ RC BTLeafNode::read(PageId pid, const PageFile& pf) {
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTLeafNode::write(PageId pid, PageFile& pf) {
+    LeafEncoding enc;
+    if (leafEncoding(keys, rids, numKeyRecords, valueSlot(), enc) > LEAF_DATA_SIZE) {
+        return RC_NODE_FULL;
+    }
+
+    BTLeafNodeBuffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    buffer.header.node.type = IS_LEAF;
+    buffer.header.node.count = numKeyRecords;
+    buffer.header.nextLeaf = nextLeaf;
+    buffer.header.prevLeaf = prevLeaf;
+    buffer.header.baseKey = numKeyRecords > 0 ? keys[0] : 0;
+    buffer.header.basePid = enc.basePid;
+    buffer.header.keyBits = enc.keyBits;
+    buffer.header.pidBits = enc.pidBits;
+    buffer.header.valuePrefix = valuePrefix;
+    buffer.header.runCount = enc.runCount;
+    buffer.header.runBits = enc.runBits;
+    modelError = keyModelError(keys, numKeyRecords);
+    if (modelError > LEAF_MODEL_MAX_ERROR) {
+        modelError = -1;
+    }
+    buffer.header.modelError = modelError + 1;
+
+    // pack into a scratch area with slack for the 8 byte stores
+    unsigned char data[LEAF_DATA_SIZE + sizeof(unsigned long long)];
+    unsigned long long values[MAX_KEY_RECORDS];
+    memset(data, 0, sizeof(data));
+    if (enc.runCount == 0) {
+        for (int i = 0; i < numKeyRecords; i++) {
+            values[i] = (unsigned int) keys[i] - (unsigned int) buffer.header.baseKey;
+        }
+        packBits(data, values, numKeyRecords, enc.keyBits);
+    } else {
+        // the key of every posting list, then the length - 1 of its run
+        unsigned long long runs[MAX_KEY_RECORDS];
+        int r = 0;
+        for (int i = 0; i < numKeyRecords; i++) {
+            if (i > 0 && keys[i] == keys[i - 1]) {
+                runs[r - 1]++;
+                continue;
+            }
+            values[r] = (unsigned int) keys[i] - (unsigned int) buffer.header.baseKey;
+            runs[r++] = 0;
+        }
+        packBits(data, values, enc.runCount, enc.keyBits);
+        packBits(data + packedSize(enc.runCount, enc.keyBits), runs, enc.runCount, enc.runBits);
+    }
+    int keyBytes = keysSize(numKeyRecords, enc.keyBits, enc.runCount, enc.runBits);
+    for (int i = 0; i < numKeyRecords; i++) {
+        values[i] = ((unsigned long long) (unsigned int) (rids[i].pid - enc.basePid) << SID_BITS) | rids[i].sid;
+    }
+    packBits(data + keyBytes, values, numKeyRecords, enc.pidBits + SID_BITS);
+    memcpy(buffer.data, data, LEAF_DATA_SIZE);
+    memcpy(buffer.data + keyBytes + packedSize(numKeyRecords, enc.pidBits + SID_BITS),
+           this->values, numKeyRecords * valueSlot());
+
     return pf.write(pid, (const void *) &buffer);
 }
 
@@ -43,7 +364,19 @@ RC BTLeafNode::write(PageId pid, PageFile& pf) {
  * @return the number of keys in the node
  */
 int BTLeafNode::getKeyCount() {
-    return buffer.numKeyRecords;
+    return numKeyRecords;
+}
+
+/*
+ * Return how full the node is.
+ * @return the fill ratio of the node between 0 and 1
+ */
+double BTLeafNode::getFillRatio() {
+    LeafEncoding enc;
+    double bytes = leafEncoding(keys, rids, numKeyRecords, valueSlot(), enc);
+    double byBytes = bytes / LEAF_DATA_SIZE;
+    double byCount = (double) numKeyRecords / MAX_KEY_RECORDS;
+    return byBytes > byCount ? byBytes : byCount;
 }
 
 /*
@@ -53,31 +386,45 @@ int BTLeafNode::getKeyCount() {
  * @return 0 if successful. Return an error code if the node is full.
  */
 RC BTLeafNode::insert(int key, const RecordId& rid) {
-    if (getKeyCount() == MAX_KEY_RECORDS) {
+    return insert(key, rid, NULL);
+}
+
+/*
+ * Insert a (key, rid) pair to the node, along with the value of its tuple.
+ * @param key[IN] the key to insert
+ * @param rid[IN] the RecordId to insert
+ * @param value[IN] the value of the tuple, NULL if it is not known
+ * @return 0 if successful. Return an error code if the node is full.
+ */
+RC BTLeafNode::insert(int key, const RecordId& rid, const char* value) {
+    int n = getKeyCount();
+    int slot = valueSlot();
+    if (n == MAX_KEY_RECORDS) {
         return RC_NODE_FULL;
     }
-    BTNodeKeyRecord keyRecordToInsert;
-    keyRecordToInsert.key = key;
-    keyRecordToInsert.rid = rid;
 
-    int i;
-    for(i = 0; i < getKeyCount() && key > buffer.keyRecords[i].key; i++) {
-    }
+    // shift the entries behind the insert position by one slot.
+    // a key goes behind the entries with the same key, so they stay in
+    // insert order and BTreeIndex::resumeScan() skips the right ones
+    int i = keyUpperBound(keys, n, key);
+    memmove(keys + i + 1, keys + i, (n - i) * sizeof(int));
+    memmove(rids + i + 1, rids + i, (n - i) * sizeof(RecordId));
+    keys[i] = key;
+    rids[i] = rid;
 
-    BTNodeKeyRecord temp[MAX_KEY_RECORDS];
-    memcpy(
-        temp,
-        buffer.keyRecords + i,
-        (MAX_KEY_RECORDS - i) * sizeof(BTNodeKeyRecord)
-    );
-    buffer.keyRecords[i] = keyRecordToInsert;
-    memcpy(
-        buffer.keyRecords + (i + 1),
-        temp,
-        (MAX_KEY_RECORDS - (i + 1)) * sizeof(BTNodeKeyRecord)
-    );
+    // the node is full when the new entry no longer packs into a page
+    if (!leafFits(keys, rids, n + 1, slot)) {
+        memmove(keys + i, keys + i + 1, (n - i) * sizeof(int));
+        memmove(rids + i, rids + i + 1, (n - i) * sizeof(RecordId));
+        return RC_NODE_FULL;
+    }
 
-    buffer.numKeyRecords++;
+    if (slot > 0) {
+        memmove(values + (i + 1) * slot, values + i * slot, (n - i) * slot);
+        encodeValue(values + i * slot, valuePrefix, value);
+    }
+    numKeyRecords++;
+    modelError = -1;
     return 0;
 }
 
@@ -93,32 +440,91 @@ RC BTLeafNode::insert(int key, const RecordId& rid) {
  */
 RC BTLeafNode::insertAndSplit(int key, const RecordId& rid, 
                               BTLeafNode& sibling, int& siblingKey) {
-    if (getKeyCount() == 0) {
-        return insert(key, rid);
+    return insertAndSplit(key, rid, NULL, sibling, siblingKey);
+}
+
+/*
+ * Insert the (key, rid) pair to the node, along with the value of its tuple,
+ * and split the node half and half with sibling.
+ * @param key[IN] the key to insert.
+ * @param rid[IN] the RecordId to insert.
+ * @param value[IN] the value of the tuple, NULL if it is not known
+ * @param sibling[IN] the sibling node to split with. This node MUST be EMPTY when this function is called.
+ * @param siblingKey[OUT] the first key in the sibling node after split.
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTLeafNode::insertAndSplit(int key, const RecordId& rid, const char* value,
+                              BTLeafNode& sibling, int& siblingKey) {
+    int n = getKeyCount();
+    if (n == 0) {
+        return insert(key, rid, value);
     }
-    if (getKeyCount() == 1) {
-        if (key > buffer.keyRecords[0].key) {
-            siblingKey = key;
-            return sibling.insert(key, rid);
-        }
-        BTNodeKeyRecord greaterKeyRecord = buffer.keyRecords[0];
-        buffer.keyRecords[0].key = key;
-        buffer.keyRecords[0].rid = rid;
-        siblingKey = greaterKeyRecord.key;
-        return sibling.insert(greaterKeyRecord.key, greaterKeyRecord.rid);
-    }
-    int half = getKeyCount() / 2;
-    int halfKey = buffer.keyRecords[half].key;
-    siblingKey = buffer.keyRecords[half + 1].key;
-    for (int i = half + 1; i < getKeyCount(); i++) {
-        BTNodeKeyRecord keyRecord = buffer.keyRecords[i];
-        RC error = sibling.insert(keyRecord.key, keyRecord.rid);
-        if (error != 0) {
-            return error;
-        }
+
+    // merge the new entry into a copy of the node
+    int slot = valueSlot();
+    int allKeys[MAX_KEY_RECORDS + 1];
+    RecordId allRids[MAX_KEY_RECORDS + 1];
+    unsigned char allValues[LEAF_DATA_SIZE + MAX_VALUE_PREFIX + 1];
+    int i = keyUpperBound(keys, n, key);
+    memcpy(allKeys, keys, i * sizeof(int));
+    memcpy(allRids, rids, i * sizeof(RecordId));
+    allKeys[i] = key;
+    allRids[i] = rid;
+    memcpy(allKeys + i + 1, keys + i, (n - i) * sizeof(int));
+    memcpy(allRids + i + 1, rids + i, (n - i) * sizeof(RecordId));
+    if (slot > 0) {
+        memcpy(allValues, values, i * slot);
+        encodeValue(allValues + i * slot, valuePrefix, value);
+        memcpy(allValues + (i + 1) * slot, values + i * slot, (n - i) * slot);
+    }
+    n++;
+
+    // split in the middle unless one half then does not pack into a page,
+    // which can happen when the new key widens the key range of its half
+    int half = leafSplitPoint(allKeys, allRids, n, slot);
+    if (half < 0) {
+        return RC_NODE_FULL;
     }
-    buffer.numKeyRecords = half + 1;
-    return key > halfKey ? sibling.insert(key, rid) : insert(key, rid);
+
+    memcpy(keys, allKeys, half * sizeof(int));
+    memcpy(rids, allRids, half * sizeof(RecordId));
+    memcpy(values, allValues, half * slot);
+    numKeyRecords = half;
+    sibling.valuePrefix = valuePrefix;
+    memcpy(sibling.keys, allKeys + half, (n - half) * sizeof(int));
+    memcpy(sibling.rids, allRids + half, (n - half) * sizeof(RecordId));
+    memcpy(sibling.values, allValues + half * slot, (n - half) * slot);
+    sibling.numKeyRecords = n - half;
+    sibling.modelError = -1;
+    modelError = -1;
+
+    siblingKey = sibling.keys[0];
+    return 0;
+}
+
+/*
+ * Start the sibling with the (key, rid) pair, keeping all entries of the node.
+ * @param key[IN] the key to insert. It must not be smaller than any key in the node.
+ * @param rid[IN] the RecordId to insert.
+ * @param value[IN] the value of the tuple, NULL if it is not known
+ * @param sibling[IN] the sibling node to split with. This node MUST be EMPTY when this function is called.
+ * @param siblingKey[OUT] the first key in the sibling node after split.
+ * @return 0 if successful. RC_INVALID_ATTRIBUTE if key is smaller than
+ *         the last key of the node.
+ */
+RC BTLeafNode::appendAndSplit(int key, const RecordId& rid, const char* value,
+                              BTLeafNode& sibling, int& siblingKey) {
+    int n = getKeyCount();
+    if (n > 0 && key < keys[n - 1]) {
+        return RC_INVALID_ATTRIBUTE;
+    }
+    sibling.valuePrefix = valuePrefix;
+    RC error = sibling.insert(key, rid, value);
+    if (error != 0) {
+        return error;
+    }
+    siblingKey = key;
+    return 0;
 }
 
 /**
@@ -133,10 +539,115 @@ RC BTLeafNode::insertAndSplit(int key, const RecordId& rid,
  * @return 0 if searchKey is found. Otherwise return an error code.
  */
 RC BTLeafNode::locate(int searchKey, int& eid) {
-    for(eid = 0;
-        eid < getKeyCount() && searchKey > buffer.keyRecords[eid].key;
-        eid++) { }
-    return searchKey == buffer.keyRecords[eid].key && eid != getKeyCount() ? 0 : RC_NO_SUCH_RECORD;
+    if (modelError >= 0) {
+        eid = keyLowerBoundNear(keys, getKeyCount(), searchKey, modelError);
+    } else {
+        eid = keyLowerBound(keys, getKeyCount(), searchKey);
+    }
+    return eid != getKeyCount() && searchKey == keys[eid] ? 0 : RC_NO_SUCH_RECORD;
+}
+
+/*
+ * Find the entry (key, rid) in the node.
+ * @param key[IN] the key of the entry
+ * @param rid[IN] the RecordId of the entry
+ * @param eid[OUT] the entry number of the entry
+ * @return 0 if the entry is found. If not, RC_NO_SUCH_RECORD.
+ */
+RC BTLeafNode::locateEntry(int key, const RecordId& rid, int& eid) {
+    for (locate(key, eid); eid < numKeyRecords && keys[eid] == key; eid++) {
+        if (rids[eid] == rid) {
+            return 0;
+        }
+    }
+    return RC_NO_SUCH_RECORD;
+}
+
+/*
+ * Remove the eid entry from the node.
+ * @param eid[IN] the entry number to remove
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTLeafNode::remove(int eid) {
+    if (eid < 0 || eid >= numKeyRecords) {
+        return RC_NO_SUCH_RECORD;
+    }
+    int slot = valueSlot();
+    memmove(keys + eid, keys + eid + 1, (numKeyRecords - eid - 1) * sizeof(int));
+    memmove(rids + eid, rids + eid + 1, (numKeyRecords - eid - 1) * sizeof(RecordId));
+    memmove(values + eid * slot, values + (eid + 1) * slot, (numKeyRecords - eid - 1) * slot);
+    numKeyRecords--;
+    modelError = -1;
+    return 0;
+}
+
+/*
+ * Move all entries of the right sibling to the end of this node.
+ * @param right[IN] the node right behind this one
+ * @return 0 if successful. RC_NODE_FULL if the entries do not fit in one node.
+ */
+RC BTLeafNode::merge(BTLeafNode& right) {
+    int n = numKeyRecords + right.numKeyRecords;
+    if (n > MAX_KEY_RECORDS) {
+        return RC_NODE_FULL;
+    }
+    int allKeys[MAX_KEY_RECORDS];
+    RecordId allRids[MAX_KEY_RECORDS];
+    memcpy(allKeys, keys, numKeyRecords * sizeof(int));
+    memcpy(allRids, rids, numKeyRecords * sizeof(RecordId));
+    memcpy(allKeys + numKeyRecords, right.keys, right.numKeyRecords * sizeof(int));
+    memcpy(allRids + numKeyRecords, right.rids, right.numKeyRecords * sizeof(RecordId));
+    int slot = valueSlot();
+    if (!leafFits(allKeys, allRids, n, slot)) {
+        return RC_NODE_FULL;
+    }
+
+    memcpy(keys, allKeys, n * sizeof(int));
+    memcpy(rids, allRids, n * sizeof(RecordId));
+    memcpy(values + numKeyRecords * slot, right.values, right.numKeyRecords * slot);
+    numKeyRecords = n;
+    right.numKeyRecords = 0;
+    right.modelError = -1;
+    modelError = -1;
+    return 0;
+}
+
+/*
+ * Spread the entries of this node and its right sibling evenly over the two.
+ * @param right[IN] the node right behind this one
+ * @param rightKey[OUT] the first key in the right node afterwards
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTLeafNode::redistribute(BTLeafNode& right, int& rightKey) {
+    int n = numKeyRecords + right.numKeyRecords;
+    int allKeys[2 * MAX_KEY_RECORDS];
+    RecordId allRids[2 * MAX_KEY_RECORDS];
+    memcpy(allKeys, keys, numKeyRecords * sizeof(int));
+    memcpy(allRids, rids, numKeyRecords * sizeof(RecordId));
+    memcpy(allKeys + numKeyRecords, right.keys, right.numKeyRecords * sizeof(int));
+    memcpy(allRids + numKeyRecords, right.rids, right.numKeyRecords * sizeof(RecordId));
+    int slot = valueSlot();
+    unsigned char allValues[2 * LEAF_DATA_SIZE];
+    memcpy(allValues, values, numKeyRecords * slot);
+    memcpy(allValues + numKeyRecords * slot, right.values, right.numKeyRecords * slot);
+
+    int half = leafSplitPoint(allKeys, allRids, n, slot);
+    if (half < 0) {
+        return RC_NODE_FULL;
+    }
+    memcpy(keys, allKeys, half * sizeof(int));
+    memcpy(rids, allRids, half * sizeof(RecordId));
+    memcpy(values, allValues, half * slot);
+    numKeyRecords = half;
+    memcpy(right.keys, allKeys + half, (n - half) * sizeof(int));
+    memcpy(right.rids, allRids + half, (n - half) * sizeof(RecordId));
+    memcpy(right.values, allValues + half * slot, (n - half) * slot);
+    right.numKeyRecords = n - half;
+    right.modelError = -1;
+    modelError = -1;
+
+    rightKey = right.keys[0];
+    return 0;
 }
 
 RC BTLeafNode::getNextCursor(IndexCursor &cursor) {
@@ -159,17 +670,64 @@ RC BTLeafNode::readEntry(int eid, int& key, RecordId& rid) {
     if (eid < 0 || eid >= getKeyCount()) {
         return RC_NO_SUCH_RECORD;
     }
-    key = buffer.keyRecords[eid].key;
-    rid = buffer.keyRecords[eid].rid;
+    key = keys[eid];
+    rid = rids[eid];
+    return 0;
+}
+
+/*
+ * Read what the eid entry holds of the value of its tuple.
+ * @param eid[IN] the entry number
+ * @param value[OUT] the value or value prefix, see IndexValue
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTLeafNode::readValue(int eid, IndexValue& value) {
+    if (eid < 0 || eid >= getKeyCount()) {
+        return RC_NO_SUCH_RECORD;
+    }
+    value.state = VALUE_UNKNOWN;
+    value.length = 0;
+    if (valuePrefix > 0) {
+        const unsigned char* slot = values + eid * valueSlot();
+        if (slot[0] == VALUE_SLOT_TRUNCATED) {
+            value.state = VALUE_TRUNCATED;
+            value.length = valuePrefix;
+        } else if (slot[0] != VALUE_SLOT_UNKNOWN) {
+            value.state = VALUE_COMPLETE;
+            value.length = slot[0];
+        }
+        memcpy(value.prefix, slot + 1, value.length);
+    }
+    value.prefix[value.length] = 0;
     return 0;
 }
 
+/*
+ * Set how long the value prefixes the node keeps are. The node must be empty.
+ * @param length[IN] the prefix length, between 0 (none) and MAX_VALUE_PREFIX
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTLeafNode::setValuePrefix(int length) {
+    if (numKeyRecords > 0 || length < 0 || length > MAX_VALUE_PREFIX) {
+        return RC_INVALID_ATTRIBUTE;
+    }
+    valuePrefix = length;
+    return 0;
+}
+
+/*
+ * @return the length of the value prefixes the node keeps, 0 if none
+ */
+int BTLeafNode::getValuePrefix() {
+    return valuePrefix;
+}
+
 /*
  * Return the pid of the next slibling node.
  * @return the PageId of the next sibling node 
  */
 PageId BTLeafNode::getNextNodePtr() {
-    return buffer.nextLeaf;
+    return nextLeaf;
 }
 
 /*
@@ -178,13 +736,33 @@ PageId BTLeafNode::getNextNodePtr() {
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTLeafNode::setNextNodePtr(PageId pid) {
-    buffer.nextLeaf = pid;
+    nextLeaf = pid;
+    return 0;
+}
+
+/*
+ * Return the pid of the previous slibling node.
+ * @return the PageId of the previous sibling node, -1 for the first leaf
+ */
+PageId BTLeafNode::getPrevNodePtr() {
+    return prevLeaf;
+}
+
+/*
+ * Set the pid of the previous slibling node.
+ * @param pid[IN] the PageId of the previous sibling node
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTLeafNode::setPrevNodePtr(PageId pid) {
+    prevLeaf = pid;
     return 0;
 }
 
-BTNonLeafNode::BTNonLeafNode(){
-    buffer.numKeys = 0;
-    buffer.flags[0] = IS_NODE;
+BTNonLeafNode::BTNonLeafNode(bool counted){
+    memset(&buffer, 0, sizeof(buffer));
+    buffer.header.type = IS_NODE;
+    memset(counts, 0, sizeof(counts));
+    this->counted = counted;
 }
 
 /*
@@ -194,13 +772,44 @@ BTNonLeafNode::BTNonLeafNode(){
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTNonLeafNode::read(PageId pid, const PageFile& pf) {
-    RC pfRC = pf.read(pid, (void *) &buffer);
+    BTNodePage page;
+    RC pfRC = page.read(pid, pf);
     if (pfRC != 0) {
         return pfRC;
     }
-    if (buffer.flags[0] != IS_NODE) {
+    return read(page);
+}
+
+/*
+ * Decode the content of the node from a page that was already read.
+ * @param page[IN] the page holding the node
+ * @return 0 if successful. RC_INVALID_ATTRIBUTE if the page holds
+ *         a different kind of node.
+ */
+RC BTNonLeafNode::read(const BTNodePage& page) {
+    if (page.getType() == IS_NODE) {
+        memcpy(&buffer, page.getBytes(), sizeof(buffer));
+        counted = false;
+        if (buffer.header.count < 0 || buffer.header.count > MAX_KEYS) {
+            return RC_INVALID_FILE_FORMAT;
+        }
+        return 0;
+    }
+    if (page.getType() != IS_COUNTED_NODE) {
         return RC_INVALID_ATTRIBUTE;
     }
+
+    const BTCountedNodeBuffer* packed = (const BTCountedNodeBuffer *) page.getBytes();
+    int n = packed->header.count;
+    if (n < 0 || n > MAX_COUNTED_KEYS) {
+        return RC_INVALID_FILE_FORMAT;
+    }
+    buffer.header.type = IS_NODE;
+    buffer.header.count = n;
+    memcpy(buffer.pageIds, packed->pageIds, (n + 1) * sizeof(PageId));
+    memcpy(buffer.keys, packed->keys, n * sizeof(int));
+    memcpy(counts, packed->counts, (n + 1) * sizeof(int));
+    counted = true;
     return 0;
 }
     
@@ -211,7 +820,19 @@ RC BTNonLeafNode::read(PageId pid, const PageFile& pf) {
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTNonLeafNode::write(PageId pid, PageFile& pf) {
-    return pf.write(pid, (const void *) &buffer);
+    if (!counted) {
+        return pf.write(pid, (const void *) &buffer);
+    }
+
+    BTCountedNodeBuffer page;
+    int n = buffer.header.count;
+    memset(&page, 0, sizeof(page));
+    page.header.type = IS_COUNTED_NODE;
+    page.header.count = n;
+    memcpy(page.pageIds, buffer.pageIds, (n + 1) * sizeof(PageId));
+    memcpy(page.keys, buffer.keys, n * sizeof(int));
+    memcpy(page.counts, counts, (n + 1) * sizeof(int));
+    return pf.write(pid, (const void *) &page);
 }
 
 /*
@@ -219,7 +840,23 @@ RC BTNonLeafNode::write(PageId pid, PageFile& pf) {
  * @return the number of keys in the node
  */
 int BTNonLeafNode::getKeyCount() {
-    return buffer.numKeys;
+    return buffer.header.count;
+}
+
+/*
+ * Return the number of keys the node can hold.
+ * @return MAX_COUNTED_KEYS if the node keeps entry counts, MAX_KEYS otherwise
+ */
+int BTNonLeafNode::getMaxKeyCount() {
+    return counted ? MAX_COUNTED_KEYS : MAX_KEYS;
+}
+
+/*
+ * Return whether the node keeps the entry count of every child.
+ * @return true if the node keeps entry counts
+ */
+bool BTNonLeafNode::hasEntryCounts() {
+    return counted;
 }
 
 
@@ -227,44 +864,35 @@ int BTNonLeafNode::getKeyCount() {
  * Insert a (key, pid) pair to the node.
  * @param key[IN] the key to insert
  * @param pid[IN] the PageId to insert
+ * @param count[IN] the number of entries in the subtree of pid
  * @return 0 if successful. Return an error code if the node is full.
  */
-RC BTNonLeafNode::insert(int key, PageId pid) {
-    if (getKeyCount() == MAX_KEYS)
-        return  RC_NODE_FULL;
-
-    int i;
-    for(i = 0; i < getKeyCount() && key > buffer.keys[i]; i++) {
-    }
+RC BTNonLeafNode::insert(int key, PageId pid, int count) {
+    return insertBehind(keyUpperBound(buffer.keys, getKeyCount(), key), key, pid, count);
+}
 
-    int temp[MAX_KEYS];
-    memcpy(
-        temp,
-        buffer.keys + i,
-        (MAX_KEYS - i) * sizeof(int)
-    );
-    buffer.keys[i] = key;
-    memcpy(
-            buffer.keys + (i + 1),
-            temp,
-            (MAX_KEYS - (i + 1)) * sizeof(int)
-    );
-    buffer.numKeys++;
-
-    i++;
-    PageId tempPageIds[MAX_KEYS + 1];
-    memcpy(
-            tempPageIds,
-            buffer.pageIds + i,
-            ((MAX_KEYS + 1) - i) * sizeof(PageId)
-    );
-    buffer.pageIds[i] = pid;
-    memcpy(
-            buffer.pageIds + (i + 1),
-            tempPageIds,
-            ((MAX_KEYS + 1) - (i + 1)) * sizeof(PageId)
-    );
+/*
+ * Insert the (key, pid) pair right behind the child-th child pointer.
+ * @param child[IN] the number of the child pointer that pid goes behind
+ * @param key[IN] the key to insert
+ * @param pid[IN] the PageId to insert
+ * @param count[IN] the number of entries in the subtree of pid
+ * @return 0 if successful. Return an error code if the node is full.
+ */
+RC BTNonLeafNode::insertBehind(int child, int key, PageId pid, int count) {
+    int n = getKeyCount();
+    if (n == getMaxKeyCount())
+        return  RC_NODE_FULL;
+    if (child < 0 || child > n)
+        return RC_INVALID_CURSOR;
 
+    memmove(buffer.keys + child + 1, buffer.keys + child, (n - child) * sizeof(int));
+    memmove(buffer.pageIds + child + 2, buffer.pageIds + child + 1, (n - child) * sizeof(PageId));
+    memmove(counts + child + 2, counts + child + 1, (n - child) * sizeof(int));
+    buffer.keys[child] = key;
+    buffer.pageIds[child + 1] = pid;
+    counts[child + 1] = count;
+    buffer.header.count++;
     return 0;
 }
 
@@ -274,64 +902,93 @@ RC BTNonLeafNode::insert(int key, PageId pid) {
  * The middle key after the split is returned in midKey.
  * @param key[IN] the key to insert
  * @param pid[IN] the PageId to insert
+ * @param count[IN] the number of entries in the subtree of pid
  * @param sibling[IN] the sibling node to split with. This node MUST be empty when this function is called.
  * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTNonLeafNode::insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, int& midKey) {
-    // Add special cases for numbers less than 4
-    if (getKeyCount() <= 1) {
+RC BTNonLeafNode::insertAndSplit(int key, PageId pid, int count, BTNonLeafNode& sibling, int& midKey) {
+    return insertBehindAndSplit(keyUpperBound(buffer.keys, getKeyCount(), key), key, pid, count, sibling, midKey);
+}
+
+/*
+ * Insert the (key, pid) pair right behind the child-th child pointer
+ * and split the node half and half with sibling.
+ * @param child[IN] the number of the child pointer that pid goes behind
+ * @param key[IN] the key to insert
+ * @param pid[IN] the PageId to insert
+ * @param count[IN] the number of entries in the subtree of pid
+ * @param sibling[IN] the sibling node to split with. This node MUST be empty when this function is called.
+ * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::insertBehindAndSplit(int child, int key, PageId pid, int count, BTNonLeafNode& sibling, int& midKey) {
+    int n = getKeyCount();
+    if (n < 2) {
         return RC_INVALID_ATTRIBUTE;
     }
+    if (child < 0 || child > n) {
+        return RC_INVALID_CURSOR;
+    }
 
-    if (getKeyCount() == 2) {
-        if (key < buffer.keys[0]) {
-            midKey = buffer.keys[0];
-            int error = sibling.initializeRoot(buffer.pageIds[1], buffer.keys[1], buffer.pageIds[2]);
-            buffer.keys[0] = key;
-            buffer.pageIds[1] = pid;
-            buffer.numKeys = 1;
-            return error;
-
-        } else if (key > buffer.keys[1]) {
-            midKey = buffer.keys[1];
-            int error = sibling.initializeRoot(buffer.pageIds[2], key, pid);
-            buffer.numKeys = 1;
-            return error;
-        } else {
-            midKey = key;
-            int error = sibling.initializeRoot(pid, buffer.keys[1], buffer.pageIds[2]);
-            buffer.numKeys = 1;
-            return error;
-        }
+    // merge the new pair into a copy of the node
+    int allKeys[MAX_KEYS + 1];
+    PageId allPids[MAX_KEYS + 2];
+    int allCounts[MAX_KEYS + 2];
+    memcpy(allKeys, buffer.keys, child * sizeof(int));
+    allKeys[child] = key;
+    memcpy(allKeys + child + 1, buffer.keys + child, (n - child) * sizeof(int));
+    memcpy(allPids, buffer.pageIds, (child + 1) * sizeof(PageId));
+    allPids[child + 1] = pid;
+    memcpy(allPids + child + 2, buffer.pageIds + child + 1, (n - child) * sizeof(PageId));
+    memcpy(allCounts, counts, (child + 1) * sizeof(int));
+    allCounts[child + 1] = count;
+    memcpy(allCounts + child + 2, counts + child + 1, (n - child) * sizeof(int));
 
-    }
+    // allKeys[half] moves up to the parent
+    int total = n + 1;
+    int half = total / 2;
+    memcpy(buffer.keys, allKeys, half * sizeof(int));
+    memcpy(buffer.pageIds, allPids, (half + 1) * sizeof(PageId));
+    memcpy(counts, allCounts, (half + 1) * sizeof(int));
+    buffer.header.count = half;
+    memcpy(sibling.buffer.keys, allKeys + half + 1, (total - half - 1) * sizeof(int));
+    memcpy(sibling.buffer.pageIds, allPids + half + 1, (total - half) * sizeof(PageId));
+    memcpy(sibling.counts, allCounts + half + 1, (total - half) * sizeof(int));
+    sibling.buffer.header.count = total - half - 1;
+    sibling.counted = counted;
 
-    int half = getKeyCount() / 2;
-    midKey = buffer.keys[half];
+    midKey = allKeys[half];
+    return 0;
+}
 
-    if (midKey > key) {
-        sibling.initializeRoot(buffer.pageIds[half + 1], buffer.keys[half + 1], buffer.pageIds[half + 2]);
-        for (int i = half + 1; i < getKeyCount(); i++) {
-            int error = sibling.insert(buffer.keys[i], buffer.pageIds[i + 1]);
-            if (error != 0) {
-                return error;
-            }
-        }
-        buffer.numKeys = half;
-        insert(key, pid);
-    } else {
-        sibling.initializeRoot(buffer.pageIds[half + 1], buffer.keys[half + 1], buffer.pageIds[half + 2]);
-        sibling.insert(key, pid);
-        for (int i = half + 2; i < getKeyCount(); i++) {
-            int error = sibling.insert(buffer.keys[i], buffer.pageIds[i + 1]);
-            if (error != 0) {
-                return error;
-            }
-        }
-        buffer.numKeys = half;
+/*
+ * Insert the (key, pid) pair behind the last child pointer and split off
+ * the last key with the pointers around it to sibling.
+ * @param key[IN] the key to insert
+ * @param pid[IN] the PageId to insert
+ * @param count[IN] the number of entries in the subtree of pid
+ * @param sibling[IN] the sibling node to split with. This node MUST be empty when this function is called.
+ * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::appendAndSplit(int key, PageId pid, int count, BTNonLeafNode& sibling, int& midKey) {
+    int n = getKeyCount();
+    if (n < 2) {
+        return RC_INVALID_ATTRIBUTE;
     }
 
+    // keys[n - 1] moves up to the parent. the sibling routes between the
+    // last child of the node and the new one by key.
+    sibling.buffer.keys[0] = key;
+    sibling.buffer.pageIds[0] = buffer.pageIds[n];
+    sibling.buffer.pageIds[1] = pid;
+    sibling.counts[0] = counts[n];
+    sibling.counts[1] = count;
+    sibling.buffer.header.count = 1;
+    sibling.counted = counted;
+    midKey = buffer.keys[n - 1];
+    buffer.header.count = n - 1;
     return 0;
 }
 
@@ -343,31 +1000,189 @@ RC BTNonLeafNode::insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, in
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTNonLeafNode::locateChildPtr(int searchKey, PageId& pid) {
-    if (buffer.numKeys == 0)
+    if (buffer.header.count == 0)
         return RC_NO_SUCH_RECORD;
 
-    int i;
-    for(i = 0; i < getKeyCount(); i++) {
-        if (searchKey < buffer.keys[i]) {
-            pid = buffer.pageIds[i];
-            return 0;
-        }
-    }
-    pid = buffer.pageIds[i];
-    return  0;
+    // follow the pointer in front of the first key larger than searchKey
+    pid = buffer.pageIds[keyUpperBound(buffer.keys, getKeyCount(), searchKey)];
+    return 0;
 }
 
 /*
  * Initialize the root node with (pid1, key, pid2).
  * @param pid1[IN] the first PageId to insert
+ * @param count1[IN] the number of entries in the subtree of pid1
  * @param key[IN] the key that should be inserted between the two PageIds
  * @param pid2[IN] the PageId to insert behind the key
+ * @param count2[IN] the number of entries in the subtree of pid2
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTNonLeafNode::initializeRoot(PageId pid1, int key, PageId pid2) {
-    buffer.numKeys = 1;
+RC BTNonLeafNode::initializeRoot(PageId pid1, int count1, int key, PageId pid2, int count2) {
+    buffer.header.count = 1;
     buffer.keys[0] = key;
     buffer.pageIds[0] = pid1;
     buffer.pageIds[1] = pid2;
+    counts[0] = count1;
+    counts[1] = count2;
+    return 0;
+}
+
+/*
+ * Return the i'th key of the node.
+ * @param i[IN] the key number, between 0 and getKeyCount() - 1
+ * @return the key
+ */
+int BTNonLeafNode::getKey(int i) {
+    return buffer.keys[i];
+}
+
+/*
+ * Set the i'th key of the node.
+ * @param i[IN] the key number, between 0 and getKeyCount() - 1
+ * @param key[IN] the new key
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::setKey(int i, int key) {
+    if (i < 0 || i >= buffer.header.count) {
+        return RC_INVALID_CURSOR;
+    }
+    buffer.keys[i] = key;
+    return 0;
+}
+
+/*
+ * Return the i'th child pointer of the node.
+ * @param i[IN] the pointer number, between 0 and getKeyCount()
+ * @return the PageId of the child
+ */
+PageId BTNonLeafNode::getChildPtr(int i) {
+    return buffer.pageIds[i];
+}
+
+/*
+ * Return the number of leaf entries in the subtree of the i'th child.
+ * @param i[IN] the pointer number, between 0 and getKeyCount()
+ * @return the entry count of the child
+ */
+int BTNonLeafNode::getEntryCount(int i) {
+    return counts[i];
+}
+
+/*
+ * Set the number of leaf entries in the subtree of the i'th child.
+ * @param i[IN] the pointer number, between 0 and getKeyCount()
+ * @param count[IN] the entry count of the child
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::setEntryCount(int i, int count) {
+    if (i < 0 || i > buffer.header.count) {
+        return RC_INVALID_CURSOR;
+    }
+    counts[i] = count;
+    return 0;
+}
+
+/*
+ * Return the number of leaf entries in the subtree of the node.
+ * @return the sum of the entry counts of the children
+ */
+int BTNonLeafNode::getTotalCount() {
+    int total = 0;
+    for (int i = 0; i <= buffer.header.count; i++) {
+        total += counts[i];
+    }
+    return total;
+}
+
+/*
+ * Find the children that may hold entries with searchKey. With duplicate
+ * keys, the entries with a separator key may be on either side of it.
+ * @param searchKey[IN] the searchKey that is being looked up.
+ * @param first[OUT] the number of the first child pointer to follow
+ * @param last[OUT] the number of the last child pointer to follow
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::locateChildRange(int searchKey, int& first, int& last) {
+    first = keyLowerBound(buffer.keys, getKeyCount(), searchKey);
+    last = keyUpperBound(buffer.keys, getKeyCount(), searchKey);
+    return 0;
+}
+
+/*
+ * Remove the i'th key and the child pointer behind it.
+ * @param i[IN] the key number, between 0 and getKeyCount() - 1
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::removeKey(int i) {
+    int n = getKeyCount();
+    if (i < 0 || i >= n) {
+        return RC_INVALID_CURSOR;
+    }
+    memmove(buffer.keys + i, buffer.keys + i + 1, (n - i - 1) * sizeof(int));
+    memmove(buffer.pageIds + i + 1, buffer.pageIds + i + 2, (n - i - 1) * sizeof(PageId));
+    memmove(counts + i + 1, counts + i + 2, (n - i - 1) * sizeof(int));
+    buffer.header.count--;
+    return 0;
+}
+
+/*
+ * Move midKey and all keys and pointers of the right sibling to the end of this node.
+ * @param midKey[IN] the key that separates this node from right in the parent
+ * @param right[IN] the node right behind this one
+ * @return 0 if successful. RC_NODE_FULL if the keys do not fit in one node.
+ */
+RC BTNonLeafNode::merge(int midKey, BTNonLeafNode& right) {
+    int n = getKeyCount();
+    int m = right.getKeyCount();
+    if (n + 1 + m > getMaxKeyCount()) {
+        return RC_NODE_FULL;
+    }
+    buffer.keys[n] = midKey;
+    memcpy(buffer.keys + n + 1, right.buffer.keys, m * sizeof(int));
+    memcpy(buffer.pageIds + n + 1, right.buffer.pageIds, (m + 1) * sizeof(PageId));
+    memcpy(counts + n + 1, right.counts, (m + 1) * sizeof(int));
+    buffer.header.count = n + 1 + m;
+    right.buffer.header.count = 0;
+    return 0;
+}
+
+/*
+ * Spread the keys and pointers of this node and its right sibling
+ * evenly over the two.
+ * @param midKey[IN] the key that separates this node from right in the parent
+ * @param right[IN] the node right behind this one
+ * @param newMidKey[OUT] the key that separates the two nodes afterwards
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::redistribute(int midKey, BTNonLeafNode& right, int& newMidKey) {
+    int n = getKeyCount();
+    int m = right.getKeyCount();
+    int allKeys[2 * MAX_KEYS + 1];
+    PageId allPids[2 * MAX_KEYS + 2];
+    int allCounts[2 * MAX_KEYS + 2];
+    memcpy(allKeys, buffer.keys, n * sizeof(int));
+    allKeys[n] = midKey;
+    memcpy(allKeys + n + 1, right.buffer.keys, m * sizeof(int));
+    memcpy(allPids, buffer.pageIds, (n + 1) * sizeof(PageId));
+    memcpy(allPids + n + 1, right.buffer.pageIds, (m + 1) * sizeof(PageId));
+    memcpy(allCounts, counts, (n + 1) * sizeof(int));
+    memcpy(allCounts + n + 1, right.counts, (m + 1) * sizeof(int));
+
+    // allKeys[half] moves up to the parent
+    int total = n + 1 + m;
+    int half = total / 2;
+    if (half > getMaxKeyCount() || total - half - 1 > getMaxKeyCount()) {
+        return RC_NODE_FULL;
+    }
+    memcpy(buffer.keys, allKeys, half * sizeof(int));
+    memcpy(buffer.pageIds, allPids, (half + 1) * sizeof(PageId));
+    memcpy(counts, allCounts, (half + 1) * sizeof(int));
+    buffer.header.count = half;
+    memcpy(right.buffer.keys, allKeys + half + 1, (total - half - 1) * sizeof(int));
+    memcpy(right.buffer.pageIds, allPids + half + 1, (total - half) * sizeof(PageId));
+    memcpy(right.counts, allCounts + half + 1, (total - half) * sizeof(int));
+    right.buffer.header.count = total - half - 1;
+
+    newMidKey = allKeys[half];
     return 0;
 }
@@ -13,10 +13,26 @@
 #include "RecordFile.h"
 #include "PageFile.h"
 
-const int MAX_KEY_RECORDS = 84;
+// the most (key, rid) entries a leaf can hold. how many of them fit in a
+// page depends on how well the entries compress, see BTLeafNodeBuffer.
+const int MAX_KEY_RECORDS = 512;
+// the most keys a nonleaf node can hold
 const int MAX_KEYS = 126;
+// the most keys a nonleaf node that also keeps the entry count of every
+// child can hold, see BTCountedNodeBuffer.
+const int MAX_COUNTED_KEYS = 84;
 const int IS_LEAF = 0;
 const int IS_NODE = 1;
+const int IS_FREE = 2;
+const int IS_COUNTED_NODE = 3;
+
+// the longest value prefix the leaves of a covering index can keep
+const int MAX_VALUE_PREFIX = 64;
+
+// how much of the value of a tuple a leaf entry holds, see IndexValue
+const int VALUE_COMPLETE = 0;
+const int VALUE_TRUNCATED = 1;
+const int VALUE_UNKNOWN = 2;
 
 
 /**
@@ -32,25 +48,136 @@ typedef struct {
     int     eid;
 } IndexCursor;
 
+/**
+ * The value of a tuple as kept in a leaf entry of a covering index.
+ * If state is VALUE_COMPLETE, prefix is the whole value. If it is
+ * VALUE_TRUNCATED, prefix holds the first length characters of a longer
+ * value. If it is VALUE_UNKNOWN, nothing about the value is known.
+ */
+typedef struct {
+    int  state;
+    int  length;
+    char prefix[MAX_VALUE_PREFIX + 1];
+} IndexValue;
+
+/**
+ * The header every node page starts with. type tells a leaf page from
+ * a nonleaf page, so a single read of a page is enough to know how to
+ * decode it.
+ */
 typedef struct {
-    int key;
-    RecordId rid;
-} BTNodeKeyRecord;
+    int type;   // IS_LEAF, IS_NODE or IS_COUNTED_NODE
+    int count;  // the number of keys in the node
+} BTNodeHeader;
 
+/**
+ * The header of a compressed leaf page.
+ * Keys are stored frame-of-reference encoded as (key - baseKey) with keyBits
+ * bits each. A RecordId is stored as (pid - basePid) with pidBits bits
+ * followed by its sid in SID_BITS bits. Every value of a node is packed
+ * with the same width, so any entry can be decoded without looking at
+ * the others. When the keys are spread evenly enough, modelError tells
+ * how far interpolation between the first and the last key can be off,
+ * and locate() only searches that neighborhood of the predicted position.
+ *
+ * A leaf with many duplicate keys stores them as posting lists instead:
+ * each of its runCount distinct keys once, with the length of its run of
+ * entries in runBits bits, and the RecordIds of all entries behind them.
+ * runCount is 0 if every entry stores its own key.
+ */
 typedef struct {
-    int numKeyRecords;
-    BTNodeKeyRecord keyRecords[MAX_KEY_RECORDS];
+    BTNodeHeader node;
     PageId nextLeaf;
-    int flags[2];
+    PageId prevLeaf;
+    int baseKey;
+    PageId basePid;
+    unsigned char keyBits;
+    unsigned char pidBits;
+    unsigned char valuePrefix;  // the length of the value prefixes, 0 if none
+    unsigned char modelError;   // 1 + the error bound of the key interpolation
+                                // model, 0 if the keys are binary searched
+    unsigned short runCount;    // the number of posting lists, 0 if none
+    unsigned char runBits;
+    unsigned char unused;
+} BTLeafPageHeader;
+
+const int SID_BITS = 4;
+const int VALUE_SLOT_TRUNCATED = 254;
+const int VALUE_SLOT_UNKNOWN = 255;
+const int LEAF_DATA_SIZE = PageFile::PAGE_SIZE - sizeof(BTLeafPageHeader);
+
+/**
+ * The leaf page layout. data holds the packed keys of all entries, or the
+ * packed keys and run lengths of the posting lists, followed by the
+ * packed RecordIds of all entries. The leaves of a covering index
+ * then hold a value slot of valuePrefix + 1 bytes per entry: the length
+ * of the value (VALUE_SLOT_TRUNCATED if it is longer than valuePrefix,
+ * VALUE_SLOT_UNKNOWN if it was not given) and its first characters.
+ */
+typedef struct {
+    BTLeafPageHeader header;
+    unsigned char data[LEAF_DATA_SIZE];
 } BTLeafNodeBuffer;
 
+/**
+ * The nonleaf page layout. pageIds[i] points to the subtree with the
+ * keys smaller than keys[i], and pageIds[header.count] to the rest.
+ * unused pads the node to a whole page.
+ */
 typedef struct {
-    int numKeys;
+    BTNodeHeader header;
     PageId pageIds[MAX_KEYS + 1];
     int keys[MAX_KEYS];
-    int flags[2];
+    int unused;
 } BTNonLeafNodeBuffer;
 
+/**
+ * The nonleaf page layout of an index that keeps entry counts.
+ * counts[i] is the number of leaf entries in the subtree of pageIds[i],
+ * so the entries in front of a key can be counted on the way down to it.
+ * The counts take a third of the page, so a node holds fewer keys.
+ */
+typedef struct {
+    BTNodeHeader header;
+    PageId pageIds[MAX_COUNTED_KEYS + 1];
+    int keys[MAX_COUNTED_KEYS];
+    int counts[MAX_COUNTED_KEYS + 1];
+} BTCountedNodeBuffer;
+
+/**
+ * BTNodePage: a node page as it was read from disk.
+ * The page is fetched once, its header tells which kind of node it
+ * holds, and the node is then decoded from the fetched copy with
+ * BTLeafNode::read(const BTNodePage&) or BTNonLeafNode::read(const BTNodePage&).
+ */
+class BTNodePage {
+  public:
+   /**
+    * Read the page pid from the PageFile pf.
+    * @param pid[IN] the PageId to read
+    * @param pf[IN] PageFile to read from
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC read(PageId pid, const PageFile& pf);
+
+   /**
+    * @return IS_LEAF, IS_NODE or IS_COUNTED_NODE, as stored in the page header
+    */
+    int getType() const;
+
+   /**
+    * @return the bytes of the page
+    */
+    const char* getBytes() const;
+
+  private:
+   /**
+    * The page, followed by 8 bytes of slack so that the leaf decoder can
+    * load a whole word at any offset inside the page.
+    */
+    unsigned long long buffer[PageFile::PAGE_SIZE / sizeof(unsigned long long) + 1];
+};
+
 /**
  * BTLeafNode: The class representing a B+tree leaf node.
  */
@@ -67,6 +194,16 @@ class BTLeafNode {
     */
     RC insert(int key, const RecordId& rid);
 
+   /**
+    * Insert the (key, rid) pair to the node, along with the value of its
+    * tuple if the node keeps value prefixes.
+    * @param key[IN] the key to insert
+    * @param rid[IN] the RecordId to insert
+    * @param value[IN] the value of the tuple, NULL if it is not known
+    * @return 0 if successful. Return an error code if the node is full.
+    */
+    RC insert(int key, const RecordId& rid, const char* value);
+
    /**
     * Insert the (key, rid) pair to the node
     * and split the node half and half with sibling.
@@ -80,6 +217,27 @@ class BTLeafNode {
     */
     RC insertAndSplit(int key, const RecordId& rid, BTLeafNode& sibling, int& siblingKey);
 
+   /**
+    * Like insertAndSplit(key, rid, sibling, siblingKey), with the value
+    * of the tuple. The sibling keeps value prefixes as long as this node's.
+    */
+    RC insertAndSplit(int key, const RecordId& rid, const char* value, BTLeafNode& sibling, int& siblingKey);
+
+   /**
+    * Start the sibling with the (key, rid) pair instead of splitting the
+    * node half and half. The node keeps all its entries. This suits the
+    * last leaf of an index that grows at its end, which an even split
+    * would leave half empty for good.
+    * @param key[IN] the key to insert. It must not be smaller than any key in the node.
+    * @param rid[IN] the RecordId to insert.
+    * @param value[IN] the value of the tuple, NULL if it is not known
+    * @param sibling[IN] the sibling node to split with. This node MUST be EMPTY when this function is called.
+    * @param siblingKey[OUT] the first key in the sibling node after split.
+    * @return 0 if successful. RC_INVALID_ATTRIBUTE if key is smaller than
+    *         the last key of the node, which is then left as it was.
+    */
+    RC appendAndSplit(int key, const RecordId& rid, const char* value, BTLeafNode& sibling, int& siblingKey);
+
    /**
     * If searchKey exists in the node, set eid to the index entry
     * with searchKey and return 0. If not, set eid to the index entry
@@ -93,6 +251,38 @@ class BTLeafNode {
     */
     RC locate(int searchKey, int& eid);
 
+   /**
+    * Find the entry (key, rid) in the node.
+    * @param key[IN] the key of the entry
+    * @param rid[IN] the RecordId of the entry
+    * @param eid[OUT] the entry number of the entry
+    * @return 0 if the entry is found. If not, RC_NO_SUCH_RECORD.
+    */
+    RC locateEntry(int key, const RecordId& rid, int& eid);
+
+   /**
+    * Remove the eid entry from the node.
+    * @param eid[IN] the entry number to remove
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC remove(int eid);
+
+   /**
+    * Move all entries of the right sibling to the end of this node.
+    * The sibling pointers of the nodes are left as they are.
+    * @param right[IN] the node right behind this one
+    * @return 0 if successful. RC_NODE_FULL if the entries do not fit in one node.
+    */
+    RC merge(BTLeafNode& right);
+
+   /**
+    * Spread the entries of this node and its right sibling evenly over the two.
+    * @param right[IN] the node right behind this one
+    * @param rightKey[OUT] the first key in the right node afterwards
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC redistribute(BTLeafNode& right, int& rightKey);
+
    /**
     * Read the (key, rid) pair from the eid entry.
     * @param eid[IN] the entry number to read the (key, rid) pair from
@@ -102,6 +292,27 @@ class BTLeafNode {
     */
     RC readEntry(int eid, int& key, RecordId& rid);
 
+   /**
+    * Read what the eid entry holds of the value of its tuple.
+    * @param eid[IN] the entry number
+    * @param value[OUT] the value or value prefix, see IndexValue.
+    *                   VALUE_UNKNOWN if the node keeps no value prefixes.
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC readValue(int eid, IndexValue& value);
+
+   /**
+    * Set how long the value prefixes the node keeps are. The node must be empty.
+    * @param length[IN] the prefix length, between 0 (none) and MAX_VALUE_PREFIX
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC setValuePrefix(int length);
+
+   /**
+    * @return the length of the value prefixes the node keeps, 0 if none
+    */
+    int getValuePrefix();
+
    /**
     * Return the pid of the next slibling node.
     * @return the PageId of the next sibling node 
@@ -116,12 +327,33 @@ class BTLeafNode {
     */
     RC setNextNodePtr(PageId pid);
 
+   /**
+    * Return the pid of the previous sibling node.
+    * @return the PageId of the previous sibling node, -1 for the first leaf
+    */
+    PageId getPrevNodePtr();
+
+   /**
+    * Set the previous sibling node PageId.
+    * @param pid[IN] the PageId of the previous sibling node
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC setPrevNodePtr(PageId pid);
+
    /**
     * Return the number of keys stored in the node.
     * @return the number of keys in the node
     */
     int getKeyCount();
 
+   /**
+    * Return how full the node is, as the larger of the fraction of
+    * MAX_KEY_RECORDS in use and the fraction of the page the packed
+    * entries take.
+    * @return the fill ratio of the node between 0 and 1
+    */
+    double getFillRatio();
+
     RC getNextCursor(IndexCursor& cursor);
  
    /**
@@ -131,6 +363,14 @@ class BTLeafNode {
     * @return 0 if successful. Return an error code if there is an error.
     */
     RC read(PageId pid, const PageFile& pf);
+
+   /**
+    * Decode the content of the node from a page that was already read.
+    * @param page[IN] the page holding the node
+    * @return 0 if successful. RC_INVALID_ATTRIBUTE if the page holds
+    *         a different kind of node.
+    */
+    RC read(const BTNodePage& page);
     
    /**
     * Write the content of the node to the page pid in the PageFile pf.
@@ -142,11 +382,29 @@ class BTLeafNode {
 
   private:
    /**
-    * The main memory buffer for loading the content of the disk page 
-    * that contains the node.
+    * The decoded content of the node. keys[i] and rids[i] form
+    * the i'th (key, rid) entry. The entries are packed into a
+    * BTLeafNodeBuffer only when the node is written.
     */
-    // char buffer[PageFile::PAGE_SIZE];
-    BTLeafNodeBuffer buffer;
+    int numKeyRecords;
+    int keys[MAX_KEY_RECORDS];
+    RecordId rids[MAX_KEY_RECORDS];
+    PageId nextLeaf;
+    PageId prevLeaf;
+
+   /**
+    * The value slots of the entries, valuePrefix + 1 bytes each, stored
+    * as they are in the page. Empty if valuePrefix is 0.
+    */
+    int valuePrefix;
+    unsigned char values[LEAF_DATA_SIZE];
+    int valueSlot() const;
+
+   /**
+    * The error bound of the key interpolation model, as written to the
+    * page. -1 if locate() binary searches, also after the keys changed.
+    */
+    int modelError;
 };
 
 
@@ -155,16 +413,33 @@ class BTLeafNode {
  */
 class BTNonLeafNode {
   public:
-    BTNonLeafNode();
+   /**
+    * @param counted[IN] whether the node keeps the entry count of every
+    *        child. This is decided again by read() from the page.
+    */
+    BTNonLeafNode(bool counted = false);
 
    /**
     * Insert a (key, pid) pair to the node.
     * Remember that all keys inside a B+tree node should be kept sorted.
     * @param key[IN] the key to insert
     * @param pid[IN] the PageId to insert
+    * @param count[IN] the number of entries in the subtree of pid
     * @return 0 if successful. Return an error code if the node is full.
     */
-    RC insert(int key, PageId pid);
+    RC insert(int key, PageId pid, int count);
+
+   /**
+    * Insert the (key, pid) pair right behind the child-th child pointer.
+    * With duplicate keys, where the pair goes cannot be told from key alone:
+    * the new right half of a split child must follow the child itself.
+    * @param child[IN] the number of the child pointer that pid goes behind
+    * @param key[IN] the key to insert
+    * @param pid[IN] the PageId to insert
+    * @param count[IN] the number of entries in the subtree of pid
+    * @return 0 if successful. Return an error code if the node is full.
+    */
+    RC insertBehind(int child, int key, PageId pid, int count);
 
    /**
     * Insert the (key, pid) pair to the node
@@ -174,11 +449,39 @@ class BTNonLeafNode {
     * Remember that all keys inside a B+tree node should be kept sorted.
     * @param key[IN] the key to insert
     * @param pid[IN] the PageId to insert
+    * @param count[IN] the number of entries in the subtree of pid
+    * @param sibling[IN] the sibling node to split with. This node MUST be empty when this function is called.
+    * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC insertAndSplit(int key, PageId pid, int count, BTNonLeafNode& sibling, int& midKey);
+
+   /**
+    * Insert the (key, pid) pair right behind the child-th child pointer
+    * and split the node half and half with sibling, like insertAndSplit.
+    * @param child[IN] the number of the child pointer that pid goes behind
+    * @param key[IN] the key to insert
+    * @param pid[IN] the PageId to insert
+    * @param count[IN] the number of entries in the subtree of pid
     * @param sibling[IN] the sibling node to split with. This node MUST be empty when this function is called.
     * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
     * @return 0 if successful. Return an error code if there is an error.
     */
-    RC insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, int& midKey);
+    RC insertBehindAndSplit(int child, int key, PageId pid, int count, BTNonLeafNode& sibling, int& midKey);
+
+   /**
+    * Insert the (key, pid) pair behind the last child pointer and split
+    * off only the last key and the pointers around it to sibling, instead
+    * of splitting half and half. The node is left one key short of full.
+    * The key in front of the last one is returned in midKey.
+    * @param key[IN] the key to insert
+    * @param pid[IN] the PageId to insert
+    * @param count[IN] the number of entries in the subtree of pid
+    * @param sibling[IN] the sibling node to split with. This node MUST be empty when this function is called.
+    * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC appendAndSplit(int key, PageId pid, int count, BTNonLeafNode& sibling, int& midKey);
 
    /**
     * Given the searchKey, find the child-node pointer to follow and
@@ -190,14 +493,95 @@ class BTNonLeafNode {
     */
     RC locateChildPtr(int searchKey, PageId& pid);
 
+   /**
+    * Find the children that may hold entries with searchKey. With duplicate
+    * keys, the entries with a separator key may be on either side of it.
+    * @param searchKey[IN] the searchKey that is being looked up.
+    * @param first[OUT] the number of the first child pointer to follow
+    * @param last[OUT] the number of the last child pointer to follow
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC locateChildRange(int searchKey, int& first, int& last);
+
+   /**
+    * Return the i'th key of the node.
+    * @param i[IN] the key number, between 0 and getKeyCount() - 1
+    * @return the key
+    */
+    int getKey(int i);
+
+   /**
+    * Set the i'th key of the node.
+    * @param i[IN] the key number, between 0 and getKeyCount() - 1
+    * @param key[IN] the new key
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC setKey(int i, int key);
+
+   /**
+    * Return the i'th child pointer of the node.
+    * @param i[IN] the pointer number, between 0 and getKeyCount()
+    * @return the PageId of the child
+    */
+    PageId getChildPtr(int i);
+
+   /**
+    * Return the number of leaf entries in the subtree of the i'th child.
+    * @param i[IN] the pointer number, between 0 and getKeyCount()
+    * @return the entry count of the child
+    */
+    int getEntryCount(int i);
+
+   /**
+    * Set the number of leaf entries in the subtree of the i'th child.
+    * @param i[IN] the pointer number, between 0 and getKeyCount()
+    * @param count[IN] the entry count of the child
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC setEntryCount(int i, int count);
+
+   /**
+    * Return the number of leaf entries in the subtree of the node.
+    * @return the sum of the entry counts of the children
+    */
+    int getTotalCount();
+
+   /**
+    * Remove the i'th key and the child pointer behind it, along with
+    * the entry count of that child.
+    * @param i[IN] the key number, between 0 and getKeyCount() - 1
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC removeKey(int i);
+
+   /**
+    * Move midKey and all keys, pointers and entry counts of the right sibling to the end of this node.
+    * @param midKey[IN] the key that separates this node from right in the parent
+    * @param right[IN] the node right behind this one
+    * @return 0 if successful. RC_NODE_FULL if the keys do not fit in one node.
+    */
+    RC merge(int midKey, BTNonLeafNode& right);
+
+   /**
+    * Spread the keys, pointers and entry counts of this node and its
+    * right sibling evenly over the two.
+    * @param midKey[IN] the key that separates this node from right in the parent
+    * @param right[IN] the node right behind this one
+    * @param newMidKey[OUT] the key that separates the two nodes afterwards
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC redistribute(int midKey, BTNonLeafNode& right, int& newMidKey);
+
    /**
     * Initialize the root node with (pid1, key, pid2).
     * @param pid1[IN] the first PageId to insert
+    * @param count1[IN] the number of entries in the subtree of pid1
     * @param key[IN] the key that should be inserted between the two PageIds
     * @param pid2[IN] the PageId to insert behind the key
+    * @param count2[IN] the number of entries in the subtree of pid2
     * @return 0 if successful. Return an error code if there is an error.
     */
-    RC initializeRoot(PageId pid1, int key, PageId pid2);
+    RC initializeRoot(PageId pid1, int count1, int key, PageId pid2, int count2);
 
    /**
     * Return the number of keys stored in the node.
@@ -205,6 +589,19 @@ class BTNonLeafNode {
     */
     int getKeyCount();
 
+   /**
+    * Return the number of keys the node can hold.
+    * @return MAX_COUNTED_KEYS if the node keeps entry counts, MAX_KEYS otherwise
+    */
+    int getMaxKeyCount();
+
+   /**
+    * Return whether the node keeps the entry count of every child.
+    * Without them, getEntryCount() returns 0.
+    * @return true if the node keeps entry counts
+    */
+    bool hasEntryCounts();
+
    /**
     * Read the content of the node from the page pid in the PageFile pf.
     * @param pid[IN] the PageId to read
@@ -212,6 +609,14 @@ class BTNonLeafNode {
     * @return 0 if successful. Return an error code if there is an error.
     */
     RC read(PageId pid, const PageFile& pf);
+
+   /**
+    * Decode the content of the node from a page that was already read.
+    * @param page[IN] the page holding the node
+    * @return 0 if successful. RC_INVALID_ATTRIBUTE if the page holds
+    *         a different kind of node.
+    */
+    RC read(const BTNodePage& page);
     
    /**
     * Write the content of the node to the page pid in the PageFile pf.
@@ -228,6 +633,11 @@ class BTNonLeafNode {
     */
     // char buffer[PageFile::PAGE_SIZE];
     BTNonLeafNodeBuffer buffer;
+
+    // the entry count of every child, kept only if counted is set.
+    // a counted node is packed into a BTCountedNodeBuffer on write().
+    int counts[MAX_KEYS + 1];
+    bool counted;
 }; 
 
 #endif /* BTREENODE_H */
@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ *
+ * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
+ * @date 3/24/2008
+ */
+
+//
+// a multi-threaded stress test and read-scaling benchmark for BTreeIndex.
+// the stress test runs inserts, removes, scans and lookups on one index
+// from several threads at once, and then checks that the index holds
+// exactly the entries it should. it is run with and without entry counts
+// and with and without pinned levels. the benchmark times the same number
+// of lookups per thread with 1, 2, 4, ... threads. the races the stress
+// test looks for show up in some runs only, so -r repeats it.
+//
+// usage: btreestress [-n entries] [-r rounds] [-t max threads] [-l lookups per thread]
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "BTreeIndex.h"
+
+using namespace std;
+
+static const char* INDEX_FILE = "btreestress.idx";
+
+// the number of threads that remove entries in the stress test
+static const int REMOVERS = 3;
+
+// the number of threads that scan and look up entries in the stress test
+static const int READERS = 2;
+
+// the number of entries a scan reads at a time
+static const int SCAN_BATCH = 100;
+
+/*
+ * The key of the i-th entry of the stress test. Every key is shared by
+ * about four entries, so the leaves hold posting lists of duplicates.
+ */
+static int stressKey(int i, int n)
+{
+    return (int) ((long long) i * 7919 % (n / 4));
+}
+
+/*
+ * Whether the i-th preloaded entry is left alone by the removers, which
+ * take the others in turns. Stable entries stay in the index for the
+ * whole run, so every lookup of their keys must find them.
+ */
+static bool isStable(int i)
+{
+    return i % (REMOVERS + 1) == REMOVERS;
+}
+
+/*
+ * Open an empty index in INDEX_FILE.
+ */
+static RC openEmpty(BTreeIndex& index, bool counted, int pinnedLevels)
+{
+    RC rc;
+    unlink(INDEX_FILE);
+    if ((rc = index.open(INDEX_FILE, 'w')) < 0) {
+        return rc;
+    }
+    index.setPinnedLevels(pinnedLevels);
+    return index.setEntryCounts(counted);
+}
+
+/*
+ * Read the entries of the index with keys in [lo, hi] with a scan.
+ * @param descending[IN] whether to scan in descending key order
+ * @return the number of entries out of order
+ */
+static int scanRange(BTreeIndex& index, int lo, int hi, bool descending, vector<pair<int, int> >& entries)
+{
+    IndexScan scan;
+    int keys[SCAN_BATCH];
+    RecordId rids[SCAN_BATCH];
+    int n;
+    int errors = 0;
+
+    entries.clear();
+    RC rc = descending ? index.openReverseScan(lo, hi, scan) : index.openScan(lo, hi, scan);
+    if (rc != 0) {
+        return 1;
+    }
+    while (index.readScan(scan, keys, rids, SCAN_BATCH, n) == 0) {
+        for (int i = 0; i < n; i++) {
+            if (keys[i] < lo || keys[i] > hi ||
+                (!entries.empty() && (descending ? keys[i] > entries.back().first : keys[i] < entries.back().first))) {
+                errors++;
+            }
+            entries.push_back(make_pair(keys[i], rids[i].pid));
+        }
+    }
+    return errors;
+}
+
+/*
+ * Read the entries of the index with keys in [lo, hi] backwards with
+ * readBackward(), from the cursor locate(hi + 1) sets.
+ * @return 1 if an entry with a key above hi is read, 0 otherwise
+ */
+static int readRangeBackward(BTreeIndex& index, int lo, int hi, vector<pair<int, int> >& entries)
+{
+    IndexCursor cursor;
+    int key;
+    RecordId rid;
+
+    entries.clear();
+    index.locate(hi + 1, cursor);
+    while (index.readBackward(cursor, key, rid) == 0 && key >= lo) {
+        if (key > hi) {
+            return 1;
+        }
+        entries.push_back(make_pair(key, rid.pid));
+    }
+    return 0;
+}
+
+/*
+ * Look up the keys with locateBatch() and one by one with locate().
+ * The index must not change meanwhile.
+ * @return the number of keys the two disagree on
+ */
+static int checkBatch(BTreeIndex& index, const vector<int>& keys)
+{
+    vector<IndexCursor> cursors(keys.size());
+    vector<RC> results(keys.size());
+    int errors = 0;
+
+    if (keys.empty() || index.locateBatch(&keys[0], keys.size(), &cursors[0], &results[0]) != 0) {
+        return keys.empty() ? 0 : 1;
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+        IndexCursor cursor;
+        RC rc = index.locate(keys[i], cursor);
+        if (rc != results[i] || cursor.pid != cursors[i].pid || cursor.eid != cursors[i].eid) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+/*
+ * Preload an index with n entries, then run REMOVERS threads that remove
+ * all but the stable ones, one thread that inserts n / 2 new entries, and
+ * READERS threads that scan the index both ways and look up the stable
+ * entries, one at a time and in batches, until the writers are done.
+ * Then check the entries that are left.
+ * @return the number of errors found
+ */
+static int stress(bool counted, int pinnedLevels, int n)
+{
+    BTreeIndex index;
+    atomic<int> errors(0);
+    atomic<bool> writing(true);
+    vector<thread> writers, readers;
+
+    if (openEmpty(index, counted, pinnedLevels) != 0) {
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        RecordId rid = { i, 0 };
+        if (index.insert(stressKey(i, n), rid) != 0) {
+            errors++;
+        }
+    }
+
+    for (int w = 0; w < REMOVERS; w++) {
+        writers.push_back(thread([&, w] {
+            for (int i = w; i < n; i += REMOVERS + 1) {
+                RecordId rid = { i, 0 };
+                if (index.remove(stressKey(i, n), rid) != 0) {
+                    errors++;
+                }
+            }
+        }));
+    }
+    writers.push_back(thread([&] {
+        for (int i = n; i < n + n / 2; i++) {
+            RecordId rid = { i, 0 };
+            if (index.insert(stressKey(i, n), rid) != 0) {
+                errors++;
+            }
+        }
+    }));
+
+    for (int r = 0; r < READERS; r++) {
+        readers.push_back(thread([&, r] {
+            vector<pair<int, int> > entries;
+            vector<int> keys;
+            for (int round = r; writing; round++) {
+                errors += scanRange(index, INT_MIN, INT_MAX, round % 2, entries);
+                keys.clear();
+                for (int i = REMOVERS + round % 97 * (REMOVERS + 1); i < n; i += 97 * (REMOVERS + 1)) {
+                    IndexCursor cursor;
+                    if (index.locate(stressKey(i, n), cursor) != 0) {
+                        errors++;
+                    }
+                    keys.push_back(stressKey(i, n));
+                }
+                if (!keys.empty()) {
+                    vector<IndexCursor> cursors(keys.size());
+                    vector<RC> results(keys.size());
+                    if (index.locateBatch(&keys[0], keys.size(), &cursors[0], &results[0]) != 0) {
+                        errors++;
+                    }
+                    errors += keys.size() - count(results.begin(), results.end(), 0);
+                }
+            }
+        }));
+    }
+
+    for (size_t i = 0; i < writers.size(); i++) {
+        writers[i].join();
+    }
+    writing = false;
+    for (size_t i = 0; i < readers.size(); i++) {
+        readers[i].join();
+    }
+
+    // the entries left are the stable ones and the ones inserted
+    vector<pair<int, int> > expected, entries;
+    for (int i = 0; i < n + n / 2; i++) {
+        if (i >= n || isStable(i)) {
+            expected.push_back(make_pair(stressKey(i, n), i));
+        }
+    }
+    sort(expected.begin(), expected.end());
+    errors += scanRange(index, INT_MIN, INT_MAX, false, entries);
+    vector<pair<int, int> > sorted(entries);
+    sort(sorted.begin(), sorted.end());
+    if (sorted != expected) {
+        fprintf(stderr, "  %d entries in the index, %d expected\n", (int) sorted.size(), (int) expected.size());
+        errors++;
+    }
+
+    // the descending scans and readBackward() return the entries of an
+    // ascending scan in the exact reverse order, whatever the range
+    vector<pair<int, int> > backward;
+    for (int lo = -1; lo <= n / 4; lo += n / 40 + 1) {
+        int hi = lo + (lo % 3 == 0 ? n / 4 : n / 100);
+        vector<pair<int, int> > forward;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].first >= lo && entries[i].first <= hi) {
+                forward.push_back(entries[i]);
+            }
+        }
+        reverse(forward.begin(), forward.end());
+        errors += scanRange(index, lo, hi, true, backward);
+        if (backward != forward) {
+            errors++;
+        }
+        errors += readRangeBackward(index, lo, hi, backward);
+        if (backward != forward) {
+            errors++;
+        }
+    }
+
+    int count;
+    if (index.countRange(INT_MIN, INT_MAX, count) != 0 || count != (int) expected.size()) {
+        errors++;
+    }
+
+    // every key, and keys on either side of them all, in no particular order
+    vector<int> keys;
+    for (int key = -1; key <= n / 4; key++) {
+        keys.push_back((int) ((long long) (key + 1) * 7919 % (n / 4 + 2)) - 1);
+    }
+    errors += checkBatch(index, keys);
+
+    index.close();
+    unlink(INDEX_FILE);
+    return errors;
+}
+
+/*
+ * Bulk load an index with n distinct keys, then time lookups per thread
+ * of random keys with 1, 2, 4, ... up to maxThreads threads at once.
+ * @return the number of errors found
+ */
+static int readScaling(bool counted, int pinnedLevels, int n, int maxThreads, int lookups)
+{
+    BTreeIndex index;
+    atomic<int> errors(0);
+
+    if (openEmpty(index, counted, pinnedLevels) != 0 || index.bulkLoadBegin(1.0) != 0) {
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        RecordId rid = { i, 0 };
+        if (index.bulkLoadAppend(2 * i, rid) != 0) {
+            errors++;
+        }
+    }
+    if (index.bulkLoadEnd() != 0) {
+        errors++;
+    }
+
+    double base = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        vector<thread> lookers;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int t = 0; t < threads; t++) {
+            lookers.push_back(thread([&, t] {
+                unsigned seed = 12345 + t;
+                for (int i = 0; i < lookups; i++) {
+                    IndexCursor cursor;
+                    seed = seed * 1103515245 + 12345;
+                    if (index.locate(2 * (int) ((seed >> 4) % n), cursor) != 0) {
+                        errors++;
+                    }
+                }
+            }));
+        }
+        for (int t = 0; t < threads; t++) {
+            lookers[t].join();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        double rate = threads * (double) lookups / seconds;
+        if (threads == 1) {
+            base = rate;
+        }
+        fprintf(stdout, "  %2d threads: %10.0f lookups/s  %5.2fx\n", threads, rate, rate / base);
+    }
+
+    index.close();
+    unlink(INDEX_FILE);
+    return errors;
+}
+
+int main(int argc, char* argv[])
+{
+    int n = 40000;
+    int maxThreads = max(4, (int) thread::hardware_concurrency());
+    int lookups = 200000;
+    int rounds = 1;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:r:t:l:")) != -1) {
+        switch (c) {
+        case 'n': n = max(8, atoi(optarg)); break;
+        case 'r': rounds = max(1, atoi(optarg)); break;
+        case 't': maxThreads = max(1, atoi(optarg)); break;
+        case 'l': lookups = max(1, atoi(optarg)); break;
+        default:
+            fprintf(stderr, "usage: %s [-n entries] [-r rounds] [-t max threads] [-l lookups per thread]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    int failed = 0;
+    for (int counted = 0; counted <= 1; counted++) {
+        for (int pinned = 0; pinned <= BTreeIndex::DEFAULT_PINNED_LEVELS; pinned += BTreeIndex::DEFAULT_PINNED_LEVELS) {
+            int failedRounds = 0;
+            for (int round = 0; round < rounds; round++) {
+                int errors = stress(counted, pinned, n);
+                if (errors) {
+                    fprintf(stderr, "  round %d: %d errors\n", round + 1, errors);
+                    failedRounds++;
+                }
+            }
+            fprintf(stdout, "stress %s, %d pinned levels, %d rounds: %s\n",
+                counted ? "counted" : "plain", pinned, rounds, failedRounds ? "FAILED" : "ok");
+            failed += failedRounds;
+        }
+    }
+
+    for (int counted = 0; counted <= 1; counted++) {
+        for (int pinned = 0; pinned <= BTreeIndex::DEFAULT_PINNED_LEVELS; pinned += BTreeIndex::DEFAULT_PINNED_LEVELS) {
+            fprintf(stdout, "read scaling %s, %d pinned levels, %d keys:\n",
+                counted ? "counted" : "plain", pinned, n);
+            if (readScaling(counted, pinned, n, maxThreads, lookups) != 0) {
+                fprintf(stderr, "  lookups failed\n");
+                failed++;
+            }
+        }
+    }
+
+    return failed ? 1 : 0;
+}
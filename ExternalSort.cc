@@ -0,0 +1,373 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include "ExternalSort.h"
+
+using namespace std;
+
+static bool entryLess(const SortEntry& e1, const SortEntry& e2)
+{
+    if (e1.key != e2.key) {
+        return e1.key < e2.key;
+    }
+    return e1.rid < e2.rid;
+}
+
+// every entry starts with its (key, rid) pair, at an int aligned address
+static const SortEntry& entryAt(const char* entry)
+{
+    return *(const SortEntry *) entry;
+}
+
+/*
+ * Orders entries by their (key, rid) pairs, or by their payloads first
+ * in a sort by payload.
+ */
+struct EntryLess {
+    int payloadSize;  // # payload bytes to sort by, 0 to sort by key
+
+    bool operator()(const char* e1, const char* e2) const {
+        if (payloadSize > 0) {
+            int c = strncmp(e1 + sizeof(SortEntry), e2 + sizeof(SortEntry), payloadSize);
+            if (c != 0) {
+                return c < 0;
+            }
+        }
+        return entryLess(entryAt(e1), entryAt(e2));
+    }
+};
+
+/*
+ * Orders merge cursors by their next entry so that
+ * the heap of cursors is a min-heap.
+ */
+struct CursorGreater {
+    const vector<ExternalSort::RunCursor>* cursors;
+
+    bool operator()(int c1, int c2) const {
+        const ExternalSort::RunCursor& r1 = (*cursors)[c1];
+        const ExternalSort::RunCursor& r2 = (*cursors)[c2];
+        return less(r2.page.entries + r2.pos * entrySize, r1.page.entries + r1.pos * entrySize);
+    }
+
+    int entrySize;
+    EntryLess less;
+};
+
+ExternalSort::ExternalSort(const string& tmpname, int memoryBytes)
+    : ExternalSort(tmpname, memoryBytes, 0)
+{
+}
+
+ExternalSort::ExternalSort(const string& tmpname, int memoryBytes, int payloadSize)
+    : ExternalSort(tmpname, memoryBytes, payloadSize, false)
+{
+}
+
+ExternalSort::ExternalSort(const string& tmpname, int memoryBytes, int payloadSize, bool byPayload)
+{
+    this->tmpname = tmpname;
+    this->payloadSize = payloadSize;
+    this->byPayload = byPayload;
+    entrySize = (sizeof(SortEntry) + payloadSize + sizeof(int) - 1) / sizeof(int) * sizeof(int);
+    entriesPerPage = sizeof(((SortPage*) 0)->entries) / entrySize;
+    capacity = memoryBytes / (entrySize + sizeof(const char*));
+    if (capacity < entriesPerPage) {
+        capacity = entriesPerPage;
+    }
+    fanIn = memoryBytes / PageFile::PAGE_SIZE - 1;
+    if (fanIn < 2) {
+        fanIn = 2;
+    }
+    buffer.reserve(capacity * entrySize);
+    bufferPos = 0;
+    mergeEntry.resize(entrySize);
+    runFileNo = 0;
+}
+
+ExternalSort::~ExternalSort()
+{
+    for (int i = 0; i < 2; i++) {
+        runFiles[i].close();
+        unlink(runFileName(i).c_str());
+    }
+}
+
+string ExternalSort::runFileName(int which) const
+{
+    char suffix[16];
+    sprintf(suffix, ".run%d", which);
+    return tmpname + suffix;
+}
+
+/*
+ * Add a pair to the sort. The sort must have no payload.
+ * @param key[IN] the key to sort by
+ * @param rid[IN] the RecordId that goes with the key
+ * @return error code. 0 if no error
+ */
+RC ExternalSort::add(int key, const RecordId& rid)
+{
+    if (payloadSize > 0) {
+        return RC_INVALID_ATTRIBUTE;
+    }
+    return add(key, rid, NULL);
+}
+
+/*
+ * Add a pair with its payload to the sort.
+ * @param key[IN] the key to sort by
+ * @param rid[IN] the RecordId that goes with the key
+ * @param payload[IN] the payloadSize bytes that go with the pair
+ * @return error code. 0 if no error
+ */
+RC ExternalSort::add(int key, const RecordId& rid, const void* payload)
+{
+    SortEntry entry;
+    entry.key = key;
+    entry.rid = rid;
+    unsigned at = buffer.size();
+    buffer.resize(at + entrySize);
+    memcpy(&buffer[at], &entry, sizeof(entry));
+    if (payload != NULL) {
+        memcpy(&buffer[at + sizeof(entry)], payload, payloadSize);
+    }
+    if ((int) (buffer.size() / entrySize) >= capacity) {
+        return spill();
+    }
+    return 0;
+}
+
+/*
+ * Sort the pairs in memory. The pairs stay where they are in buffer,
+ * and sorted points to them in order.
+ */
+void ExternalSort::sortBuffer()
+{
+    sorted.clear();
+    for (unsigned at = 0; at < buffer.size(); at += entrySize) {
+        sorted.push_back(&buffer[at]);
+    }
+    EntryLess less = { byPayload ? payloadSize : 0 };
+    sort(sorted.begin(), sorted.end(), less);
+}
+
+/*
+ * Sort the pairs in memory and append them to the run file as a new run.
+ */
+RC ExternalSort::spill()
+{
+    RC rc;
+    PageFile& pf = runFiles[runFileNo];
+    if (runs.empty()) {
+        unlink(runFileName(runFileNo).c_str());
+        if ((rc = pf.open(runFileName(runFileNo), 'w')) < 0) {
+            return rc;
+        }
+    }
+
+    sortBuffer();
+
+    Run run;
+    run.begin = pf.endPid();
+    SortPage page;
+    for (unsigned i = 0; i < sorted.size(); i += entriesPerPage) {
+        page.count = min((unsigned) entriesPerPage, (unsigned) sorted.size() - i);
+        for (int j = 0; j < page.count; j++) {
+            memcpy(page.entries + j * entrySize, sorted[i + j], entrySize);
+        }
+        if ((rc = pf.write(pf.endPid(), &page)) < 0) {
+            return rc;
+        }
+    }
+    run.end = pf.endPid();
+    runs.push_back(run);
+
+    buffer.clear();
+    sorted.clear();
+    return 0;
+}
+
+/*
+ * End the input and merge the runs until one merge pass is left.
+ * @return error code. 0 if no error
+ */
+RC ExternalSort::finish()
+{
+    RC rc;
+
+    // everything fit in memory: no need to go to disk at all
+    if (runs.empty()) {
+        sortBuffer();
+        bufferPos = 0;
+        return 0;
+    }
+
+    if (!buffer.empty() && (rc = spill()) < 0) {
+        return rc;
+    }
+    vector<char>().swap(buffer);
+    vector<const char*>().swap(sorted);
+
+    while ((int) runs.size() > fanIn) {
+        if ((rc = mergePass()) < 0) {
+            return rc;
+        }
+    }
+    return openMerge(0, runs.size());
+}
+
+/*
+ * Merge every fanIn runs of the run file into one run of the other run file.
+ */
+RC ExternalSort::mergePass()
+{
+    RC rc;
+    int out = 1 - runFileNo;
+    PageFile& pf = runFiles[out];
+    unlink(runFileName(out).c_str());
+    if ((rc = pf.open(runFileName(out), 'w')) < 0) {
+        return rc;
+    }
+
+    vector<Run> merged;
+    for (unsigned first = 0; first < runs.size(); first += fanIn) {
+        if ((rc = openMerge(first, min((unsigned) fanIn, (unsigned) runs.size() - first))) < 0) {
+            return rc;
+        }
+
+        Run run;
+        run.begin = pf.endPid();
+        SortPage page;
+        page.count = 0;
+        const char* entry;
+        while ((rc = mergeNext(entry)) == 0) {
+            memcpy(page.entries + page.count * entrySize, entry, entrySize);
+            if (++page.count == entriesPerPage) {
+                if ((rc = pf.write(pf.endPid(), &page)) < 0) {
+                    return rc;
+                }
+                page.count = 0;
+            }
+        }
+        if (rc != RC_END_OF_TREE) {
+            return rc;
+        }
+        if (page.count > 0 && (rc = pf.write(pf.endPid(), &page)) < 0) {
+            return rc;
+        }
+        run.end = pf.endPid();
+        merged.push_back(run);
+    }
+
+    // the runs of the input file are no longer needed
+    runFiles[runFileNo].close();
+    unlink(runFileName(runFileNo).c_str());
+    runFileNo = out;
+    runs.swap(merged);
+    return 0;
+}
+
+/*
+ * Start a k-way merge of the runs [first, first + count) of the run file.
+ */
+RC ExternalSort::openMerge(int first, int count)
+{
+    RC rc;
+    cursors.resize(count);
+    heap.clear();
+    for (int i = 0; i < count; i++) {
+        RunCursor& c = cursors[i];
+        c.pid = runs[first + i].begin;
+        c.end = runs[first + i].end;
+        c.pos = 0;
+        if (c.pid < c.end) {
+            if ((rc = runFiles[runFileNo].read(c.pid, &c.page)) < 0) {
+                return rc;
+            }
+            heap.push_back(i);
+        }
+    }
+
+    CursorGreater greater = { &cursors, entrySize, { byPayload ? payloadSize : 0 } };
+    make_heap(heap.begin(), heap.end(), greater);
+    return 0;
+}
+
+/*
+ * Take the smallest entry of the runs being merged. entry points to it
+ * until the next call.
+ */
+RC ExternalSort::mergeNext(const char*& entry)
+{
+    if (heap.empty()) {
+        return RC_END_OF_TREE;
+    }
+
+    CursorGreater greater = { &cursors, entrySize, { byPayload ? payloadSize : 0 } };
+    pop_heap(heap.begin(), heap.end(), greater);
+    RunCursor& c = cursors[heap.back()];
+
+    // the entry is copied out of the page before the page is refilled
+    memcpy(&mergeEntry[0], c.page.entries + c.pos++ * entrySize, entrySize);
+    entry = &mergeEntry[0];
+
+    // refill the cursor from the next page of its run once its page is used up
+    if (c.pos == c.page.count) {
+        c.pos = 0;
+        if (++c.pid == c.end) {
+            heap.pop_back();
+            return 0;
+        }
+        RC rc = runFiles[runFileNo].read(c.pid, &c.page);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    push_heap(heap.begin(), heap.end(), greater);
+    return 0;
+}
+
+/*
+ * Return the next pair in sorted order. The sort must have no payload.
+ * @param key[OUT] the key of the pair
+ * @param rid[OUT] the RecordId of the pair
+ * @return error code. RC_END_OF_TREE when all pairs have been returned
+ */
+RC ExternalSort::next(int& key, RecordId& rid)
+{
+    if (payloadSize > 0) {
+        return RC_INVALID_ATTRIBUTE;
+    }
+    return next(key, rid, NULL);
+}
+
+/*
+ * Return the next pair in sorted order with its payload.
+ * @param key[OUT] the key of the pair
+ * @param rid[OUT] the RecordId of the pair
+ * @param payload[OUT] room for the payloadSize bytes of the pair
+ * @return error code. RC_END_OF_TREE when all pairs have been returned
+ */
+RC ExternalSort::next(int& key, RecordId& rid, void* payload)
+{
+    const char* entry;
+    if (runs.empty()) {
+        if (bufferPos >= sorted.size()) {
+            return RC_END_OF_TREE;
+        }
+        entry = sorted[bufferPos++];
+    } else {
+        RC rc = mergeNext(entry);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    key = entryAt(entry).key;
+    rid = entryAt(entry).rid;
+    if (payload != NULL) {
+        memcpy(payload, entry + sizeof(SortEntry), payloadSize);
+    }
+    return 0;
+}
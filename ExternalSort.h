@@ -0,0 +1,154 @@
+#ifndef EXTERNALSORT_H
+#define EXTERNALSORT_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include "RecordFile.h"
+
+/**
+ * A (key, RecordId) pair being sorted. In a sort with a payload,
+ * every pair is followed by payloadSize bytes that travel with it.
+ */
+typedef struct {
+    int key;
+    RecordId rid;
+} SortEntry;
+
+/**
+ * A page of a sorted run on disk, holding count entries
+ * of the size the sort uses, one after the other.
+ */
+typedef struct {
+    int count;
+    char entries[PageFile::PAGE_SIZE - sizeof(int)];
+} SortPage;
+
+/**
+ * ExternalSort: sorts (key, RecordId) pairs by key (ties by RecordId)
+ * within a fixed memory budget. A sort by payload puts the pairs in the
+ * order of their payloads, NUL-padded strings, before that.
+ * Pairs are collected in memory until the budget is used up, then sorted
+ * and spilled as a run to a temporary PageFile. finish() merges the runs
+ * k ways at a time, with k limited by the pages that fit in the budget,
+ * until one merge pass is left, and next() streams the output of that
+ * last pass. If all pairs fit in memory, nothing is written to disk.
+ */
+class ExternalSort {
+  public:
+   /**
+    * @param tmpname[IN] the prefix of the temporary files for the runs
+    * @param memoryBytes[IN] the memory budget of the sort
+    */
+    ExternalSort(const std::string& tmpname, int memoryBytes);
+
+   /**
+    * @param tmpname[IN] the prefix of the temporary files for the runs
+    * @param memoryBytes[IN] the memory budget of the sort
+    * @param payloadSize[IN] the bytes of payload that go with every pair
+    */
+    ExternalSort(const std::string& tmpname, int memoryBytes, int payloadSize);
+
+   /**
+    * @param tmpname[IN] the prefix of the temporary files for the runs
+    * @param memoryBytes[IN] the memory budget of the sort
+    * @param payloadSize[IN] the bytes of payload that go with every pair
+    * @param byPayload[IN] whether to sort by the payload first. The payload
+    *        is then a string, padded with NULs to payloadSize bytes.
+    */
+    ExternalSort(const std::string& tmpname, int memoryBytes, int payloadSize, bool byPayload);
+
+   /**
+    * Remove the temporary files that are left.
+    */
+    ~ExternalSort();
+
+   /**
+    * Add a pair to the sort. Must not be called after finish().
+    * @param key[IN] the key to sort by
+    * @param rid[IN] the RecordId that goes with the key
+    * @return error code. RC_INVALID_ATTRIBUTE if the sort has a payload
+    */
+    RC add(int key, const RecordId& rid);
+
+   /**
+    * Add a pair with its payload to the sort. Must not be called after finish().
+    * @param key[IN] the key to sort by
+    * @param rid[IN] the RecordId that goes with the key
+    * @param payload[IN] the payloadSize bytes that go with the pair
+    * @return error code. 0 if no error
+    */
+    RC add(int key, const RecordId& rid, const void* payload);
+
+   /**
+    * End the input and merge the runs until one merge pass is left.
+    * @return error code. 0 if no error
+    */
+    RC finish();
+
+   /**
+    * Return the next pair in sorted order. Must be called after finish().
+    * @param key[OUT] the key of the pair
+    * @param rid[OUT] the RecordId of the pair
+    * @return error code. RC_END_OF_TREE when all pairs have been returned,
+    *         RC_INVALID_ATTRIBUTE if the sort has a payload
+    */
+    RC next(int& key, RecordId& rid);
+
+   /**
+    * Return the next pair in sorted order with its payload.
+    * @param key[OUT] the key of the pair
+    * @param rid[OUT] the RecordId of the pair
+    * @param payload[OUT] room for the payloadSize bytes of the pair
+    * @return error code. RC_END_OF_TREE when all pairs have been returned
+    */
+    RC next(int& key, RecordId& rid, void* payload);
+
+   /**
+    * The read position in a run being merged.
+    */
+    typedef struct {
+        PageId   pid;    // the page loaded in page
+        PageId   end;    // the page behind the last page of the run
+        int      pos;    // the next entry to return from page
+        SortPage page;   // the current page of the run
+    } RunCursor;
+
+  private:
+    typedef struct {
+        PageId begin;    // the first page of the run
+        PageId end;      // the page behind the last page of the run
+    } Run;
+
+    RC spill();
+    RC openMerge(int first, int count);
+    RC mergeNext(const char*& entry);
+    RC mergePass();
+    void sortBuffer();
+    std::string runFileName(int which) const;
+
+    std::string tmpname;              // prefix of the temporary files
+    int         payloadSize;          // # payload bytes of a pair
+    bool        byPayload;            // whether pairs are sorted by
+                                      // their payload first
+    int         entrySize;            // # bytes of a pair with its payload
+    int         entriesPerPage;       // # pairs in a page of a run
+    int         capacity;             // # pairs that fit in the budget
+    int         fanIn;                // # runs merged at a time
+
+    std::vector<char>        buffer;    // the pairs kept in memory
+    std::vector<const char*> sorted;    // the pairs of buffer in sorted order
+    unsigned                 bufferPos; // next pair of sorted to return
+
+    PageFile         runFiles[2];     // the runs of the current and of
+                                      // the next merge pass
+    int              runFileNo;       // which of runFiles holds the runs
+    std::vector<Run> runs;            // the runs in runFiles[runFileNo]
+
+    std::vector<RunCursor> cursors;   // the runs being merged
+    std::vector<int>       heap;      // min-heap of cursors by next entry
+    std::vector<char>      mergeEntry; // the last entry taken from the merge
+};
+
+#endif /* EXTERNALSORT_H */
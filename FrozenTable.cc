@@ -0,0 +1,246 @@
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "FrozenTable.h"
+#include "RecordFile.h"
+
+using namespace std;
+
+typedef struct {
+    int key;
+    string value;
+} FrozenTuple;
+
+static bool tupleLess(const FrozenTuple& t1, const FrozenTuple& t2)
+{
+    return t1.key < t2.key;
+}
+
+FrozenTable::FrozenTable()
+{
+    data = NULL;
+    size = 0;
+    header = NULL;
+    dir = NULL;
+}
+
+FrozenTable::~FrozenTable()
+{
+    if (data != NULL) {
+        close();
+    }
+}
+
+/*
+ * Build the frozen snapshot table.frz from the table file table.tbl.
+ * @param table[IN] the name of the table
+ * @return error code. 0 if no error
+ */
+RC FrozenTable::freeze(const string& table)
+{
+    RecordFile rf;
+    RC rc;
+    if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
+        return rc;
+    }
+
+    // pull the whole table into memory and sort it by key
+    vector<FrozenTuple> tuples;
+    RecordBatch* batch = new RecordBatch;
+    RecordId rid;
+    rid.pid = rid.sid = 0;
+    while (rid < rf.endRid()) {
+        if ((rc = rf.readBatch(rid, *batch)) < 0) {
+            delete batch;
+            rf.close();
+            return rc;
+        }
+        for (int i = 0; i < batch->count; i++) {
+            FrozenTuple t;
+            t.key = batch->keys[i];
+            t.value.assign(batch->values[i], batch->valueLengths[i]);
+            tuples.push_back(t);
+        }
+    }
+    delete batch;
+    rf.close();
+    stable_sort(tuples.begin(), tuples.end(), tupleLess);
+
+    // write into a temporary file first so that a reader never maps
+    // a half written snapshot
+    string filename = table + ".frz";
+    string tmpname = filename + ".tmp";
+    FILE* f = fopen(tmpname.c_str(), "wb");
+    if (f == NULL) {
+        return RC_FILE_OPEN_FAILED;
+    }
+
+    FrozenTableHeader h;
+    h.magic = MAGIC;
+    h.tupleCount = tuples.size();
+    h.dirCount = 0;
+    h.dirOffset = 0;
+    fwrite(&h, sizeof(h), 1, f);
+
+    vector<FrozenDirEntry> directory;
+    int offset = sizeof(h);
+    for (int i = 0; i < (int) tuples.size(); i++) {
+        if (i % DIR_INTERVAL == 0) {
+            FrozenDirEntry e;
+            e.key = tuples[i].key;
+            e.offset = offset;
+            directory.push_back(e);
+        }
+        unsigned char length = tuples[i].value.size();
+        fwrite(&tuples[i].key, sizeof(int), 1, f);
+        fwrite(&length, 1, 1, f);
+        fwrite(tuples[i].value.c_str(), 1, length + 1, f);
+        offset += sizeof(int) + 1 + length + 1;
+    }
+
+    h.dirCount = directory.size();
+    h.dirOffset = offset;
+    if (!directory.empty()) {
+        fwrite(&directory[0], sizeof(FrozenDirEntry), directory.size(), f);
+    }
+
+    // now that the directory location is known, finish the header
+    fseek(f, 0, SEEK_SET);
+    fwrite(&h, sizeof(h), 1, f);
+    if (ferror(f)) {
+        fclose(f);
+        unlink(tmpname.c_str());
+        return RC_FILE_WRITE_FAILED;
+    }
+    if (fclose(f) != 0) {
+        unlink(tmpname.c_str());
+        return RC_FILE_WRITE_FAILED;
+    }
+
+    return rename(tmpname.c_str(), filename.c_str()) == 0 ? 0 : RC_FILE_WRITE_FAILED;
+}
+
+/*
+ * Map a frozen table file into memory for reading.
+ * @param filename[IN] the name of the frozen table file
+ * @return error code. 0 if no error
+ */
+RC FrozenTable::open(const string& filename)
+{
+    if (data != NULL) {
+        return RC_FILE_OPEN_FAILED;
+    }
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return RC_FILE_OPEN_FAILED;
+    }
+
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) < 0 || statbuf.st_size < (off_t) sizeof(FrozenTableHeader)) {
+        ::close(fd);
+        return RC_INVALID_FILE_FORMAT;
+    }
+
+    void* p = mmap(NULL, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        return RC_FILE_OPEN_FAILED;
+    }
+
+    data = (const char*) p;
+    size = statbuf.st_size;
+    header = (const FrozenTableHeader*) data;
+    if (header->magic != MAGIC ||
+        header->dirOffset + header->dirCount * (int) sizeof(FrozenDirEntry) > size) {
+        close();
+        return RC_INVALID_FILE_FORMAT;
+    }
+    dir = (const FrozenDirEntry*) (data + header->dirOffset);
+    return 0;
+}
+
+/*
+ * Unmap the frozen table file.
+ * @return error code. 0 if no error
+ */
+RC FrozenTable::close()
+{
+    if (data == NULL) {
+        return RC_FILE_CLOSE_FAILED;
+    }
+    munmap((void*) data, size);
+    data = NULL;
+    size = 0;
+    header = NULL;
+    dir = NULL;
+    return 0;
+}
+
+int FrozenTable::getTupleCount() const
+{
+    return header->tupleCount;
+}
+
+/*
+ * Set cursor to the first tuple whose key is not smaller than searchKey.
+ * @param searchKey[IN] the key to find
+ * @param cursor[OUT] the cursor pointing to the first tuple with
+ *                    key >= searchKey
+ * @return 0 if searchKey is found. Otherwise RC_NO_SUCH_RECORD.
+ */
+RC FrozenTable::locate(int searchKey, FrozenCursor& cursor) const
+{
+    // find the last directory entry whose key is smaller than searchKey.
+    // the first tuple with key >= searchKey is at most DIR_INTERVAL
+    // tuples behind it.
+    int lo = 0, hi = header->dirCount;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (dir[mid].key < searchKey) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    cursor = (lo == 0) ? sizeof(FrozenTableHeader) : dir[lo - 1].offset;
+
+    int key;
+    const char* value;
+    int length;
+    FrozenCursor next = cursor;
+    while (readForward(next, key, value, length) == 0) {
+        if (key >= searchKey) {
+            return key == searchKey ? 0 : RC_NO_SUCH_RECORD;
+        }
+        cursor = next;
+    }
+    return RC_NO_SUCH_RECORD;
+}
+
+/*
+ * Read the tuple at cursor and move the cursor to the next tuple.
+ * @param cursor[IN/OUT] the cursor pointing to a tuple
+ * @param key[OUT] the key of the tuple
+ * @param value[OUT] the value of the tuple
+ * @param length[OUT] the length of the value
+ * @return error code. RC_END_OF_TREE if the cursor is at the end.
+ */
+RC FrozenTable::readForward(FrozenCursor& cursor, int& key, const char*& value, int& length) const
+{
+    if (cursor >= header->dirOffset) {
+        return RC_END_OF_TREE;
+    }
+    const char* p = data + cursor;
+    memcpy(&key, p, sizeof(int));
+    length = (unsigned char) p[sizeof(int)];
+    value = p + sizeof(int) + 1;
+    cursor += sizeof(int) + 1 + length + 1;
+    return 0;
+}
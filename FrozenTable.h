@@ -0,0 +1,106 @@
+#ifndef FROZENTABLE_H
+#define FROZENTABLE_H
+
+#include <string>
+#include "Bruinbase.h"
+
+/**
+ * The header at the beginning of a frozen table file.
+ * The file is laid out as
+ *   [FrozenTableHeader][tuples sorted by key][sparse key directory]
+ * and every tuple is stored as
+ *   [int key][unsigned char length][value bytes][terminating '\0']
+ * with no alignment or per-page padding.
+ */
+typedef struct {
+    int magic;        // FrozenTable::MAGIC
+    int tupleCount;   // # tuples in the file
+    int dirCount;     // # entries in the sparse key directory
+    int dirOffset;    // byte offset of the sparse key directory
+} FrozenTableHeader;
+
+/**
+ * An entry of the sparse key directory. One entry is kept for every
+ * FrozenTable::DIR_INTERVAL tuples and points to the first of them.
+ */
+typedef struct {
+    int key;          // the key of the tuple
+    int offset;       // byte offset of the tuple
+} FrozenDirEntry;
+
+/**
+ * The position of a tuple in a frozen table (its byte offset).
+ */
+typedef int FrozenCursor;
+
+/**
+ * FrozenTable: an immutable, densely packed, read-only snapshot of a table.
+ * The file is memory mapped on open, so opening it does not parse or copy
+ * anything; tuples are read directly out of the mapping.
+ */
+class FrozenTable {
+  public:
+    static const int MAGIC = 0x5a524642;    // "BFRZ"
+    static const int DIR_INTERVAL = 64;     // tuples per directory entry
+
+    FrozenTable();
+    ~FrozenTable();
+
+   /**
+    * Build the frozen snapshot table.frz from the table file table.tbl.
+    * An existing snapshot is replaced.
+    * @param table[IN] the name of the table
+    * @return error code. 0 if no error
+    */
+    static RC freeze(const std::string& table);
+
+   /**
+    * Map a frozen table file into memory for reading.
+    * @param filename[IN] the name of the frozen table file
+    * @return error code. 0 if no error
+    */
+    RC open(const std::string& filename);
+
+   /**
+    * Unmap the frozen table file.
+    * @return error code. 0 if no error
+    */
+    RC close();
+
+   /**
+    * Return the number of tuples in the table.
+    * @return the number of tuples in the table
+    */
+    int getTupleCount() const;
+
+   /**
+    * Set cursor to the first tuple whose key is not smaller than searchKey.
+    * The sparse directory is binary searched first, so at most
+    * DIR_INTERVAL tuples are looked at afterwards.
+    * @param searchKey[IN] the key to find
+    * @param cursor[OUT] the cursor pointing to the first tuple with
+    *                    key >= searchKey
+    * @return 0 if searchKey is found. Otherwise RC_NO_SUCH_RECORD.
+    */
+    RC locate(int searchKey, FrozenCursor& cursor) const;
+
+   /**
+    * Read the tuple at cursor and move the cursor to the next tuple.
+    * The value is not copied: it points into the mapped file and is
+    * '\0' terminated.
+    * @param cursor[IN/OUT] the cursor pointing to a tuple
+    * @param key[OUT] the key of the tuple
+    * @param value[OUT] the value of the tuple
+    * @param length[OUT] the length of the value
+    * @return error code. RC_END_OF_TREE if the cursor is at the end.
+    */
+    RC readForward(FrozenCursor& cursor, int& key, const char*& value, int& length) const;
+
+  private:
+    const char*              data;     // the mapped file
+    int                      size;     // the size of the mapped file
+    const FrozenTableHeader* header;   // the header at the start of data
+    const FrozenDirEntry*    dir;      // the sparse key directory
+};
+
+#endif /* FROZENTABLE_H */
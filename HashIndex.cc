@@ -0,0 +1,490 @@
+#include <cstring>
+#include "HashIndex.h"
+
+using namespace std;
+
+static_assert(sizeof(HashMetaPage) == PageFile::PAGE_SIZE &&
+              sizeof(HashDirPage) == PageFile::PAGE_SIZE &&
+              sizeof(HashBucketPage) == PageFile::PAGE_SIZE,
+              "a hash index page must take exactly one page");
+static_assert((1 << HashIndex::MAX_GLOBAL_DEPTH) <= 251 * HashIndex::DIR_ENTRIES,
+              "the largest directory must fit in the pages the meta page lists");
+
+/*
+ * Spread the bits of a key over the whole hash value, so that the
+ * low bits the directory is indexed by differ even for keys that are
+ * close together (the 64-bit finalizer of MurmurHash3).
+ */
+static unsigned int hashKey(long long key)
+{
+    unsigned long long h = (unsigned long long) key;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (unsigned int) h;
+}
+
+/*
+ * Hash a value to 64 bits (FNV-1a). Two different values of a table
+ * rarely share a hash, but they may, so it only narrows the search down.
+ * @param value[IN] the value to hash
+ * @return the 64-bit key the value is stored under
+ */
+long long HashIndex::hashValue(const string& value)
+{
+    unsigned long long h = 0xcbf29ce484222325ULL;
+    for (unsigned i = 0; i < value.size(); i++) {
+        h ^= (unsigned char) value[i];
+        h *= 0x100000001b3ULL;
+    }
+    return (long long) h;
+}
+
+HashIndex::HashIndex()
+{
+    globalDepth = 0;
+    entryCount = 0;
+    freePid = -1;
+    dirty = false;
+}
+
+/*
+ * Open the index file in read or write mode.
+ * Under 'w' mode, the index file is created if it does not exist.
+ * @param indexname[IN] the name of the index file
+ * @param mode[IN] 'r' for read, 'w' for write
+ * @return error code. 0 if no error
+ */
+RC HashIndex::open(const string& indexname, char mode)
+{
+    RC error = pf.open(indexname, mode);
+    if (error != 0) {
+        return error;
+    }
+    directory.clear();
+    dirPids.clear();
+    dirty = false;
+
+    if (pf.endPid() == 0) {
+        // a new index is a single empty bucket that all keys hash to
+        HashBucketPage bucket;
+        memset(&bucket, 0, sizeof(bucket));
+        bucket.overflow = -1;
+        globalDepth = 0;
+        entryCount = 0;
+        freePid = -1;
+        directory.push_back(1);
+        if ((error = writeBucket(1, bucket)) != 0) {
+            pf.close();
+            return error;
+        }
+        return writeDirectory();
+    }
+
+    HashMetaPage meta;
+    if ((error = pf.read(0, &meta)) != 0) {
+        pf.close();
+        return error;
+    }
+    if (meta.magic != MAGIC || meta.globalDepth < 0 || meta.globalDepth > MAX_GLOBAL_DEPTH ||
+        meta.dirPageCount < 0 || meta.dirPageCount > 251) {
+        pf.close();
+        return RC_INVALID_FILE_FORMAT;
+    }
+    globalDepth = meta.globalDepth;
+    entryCount = meta.entryCount;
+    freePid = meta.freePid;
+    dirPids.assign(meta.dirPids, meta.dirPids + meta.dirPageCount);
+
+    int size = 1 << globalDepth;
+    directory.resize(size);
+    for (int i = 0; i < size; i += DIR_ENTRIES) {
+        HashDirPage page;
+        if ((error = pf.read(dirPids[i / DIR_ENTRIES], &page)) != 0) {
+            pf.close();
+            return error;
+        }
+        int n = size - i < DIR_ENTRIES ? size - i : DIR_ENTRIES;
+        memcpy(&directory[i], page.buckets, n * sizeof(PageId));
+    }
+    return 0;
+}
+
+/*
+ * Write the directory back if it changed and close the index file.
+ * @return error code. 0 if no error
+ */
+RC HashIndex::close()
+{
+    RC error = dirty ? writeDirectory() : 0;
+    RC closeError = pf.close();
+    return error != 0 ? error : closeError;
+}
+
+/*
+ * Write the meta page and the pages of the directory.
+ */
+RC HashIndex::writeDirectory()
+{
+    RC error;
+    int size = 1 << globalDepth;
+    while ((int) dirPids.size() * DIR_ENTRIES < size) {
+        PageId pid;
+        if ((error = allocatePage(pid)) != 0) {
+            return error;
+        }
+        dirPids.push_back(pid);
+    }
+    for (int i = 0; i < size; i += DIR_ENTRIES) {
+        HashDirPage page;
+        memset(&page, 0, sizeof(page));
+        int n = size - i < DIR_ENTRIES ? size - i : DIR_ENTRIES;
+        memcpy(page.buckets, &directory[i], n * sizeof(PageId));
+        if ((error = pf.write(dirPids[i / DIR_ENTRIES], &page)) != 0) {
+            return error;
+        }
+    }
+
+    HashMetaPage meta;
+    memset(&meta, 0, sizeof(meta));
+    meta.magic = MAGIC;
+    meta.globalDepth = globalDepth;
+    meta.entryCount = entryCount;
+    meta.freePid = freePid;
+    meta.dirPageCount = dirPids.size();
+    for (unsigned i = 0; i < dirPids.size(); i++) {
+        meta.dirPids[i] = dirPids[i];
+    }
+    if ((error = pf.write(0, &meta)) != 0) {
+        return error;
+    }
+    dirty = false;
+    return 0;
+}
+
+/*
+ * Insert (key, RecordId) pair to the index.
+ * The pair goes to the first page of its bucket with room. If the bucket
+ * is full, it is split until the pair finds room, unless all its keys
+ * hash like the new key, in which case an overflow page is added.
+ * @param key[IN] the key for the value inserted into the index
+ * @param rid[IN] the RecordId for the record being inserted into the index
+ * @return error code. 0 if no error
+ */
+RC HashIndex::insert(long long key, const RecordId& rid)
+{
+    RC error;
+    unsigned int h = hashKey(key);
+    unsigned int splitMask = (1u << MAX_GLOBAL_DEPTH) - 1;
+
+    for (;;) {
+        int slot = h & ((1u << globalDepth) - 1);
+        PageId pid = directory[slot];
+        HashBucketPage bucket;
+        bool splittable = false;
+        int localDepth = 0;
+
+        while (pid != -1) {
+            if ((error = readBucket(pid, bucket)) != 0) {
+                return error;
+            }
+            if (bucket.count < BUCKET_ENTRIES) {
+                bucket.keys[bucket.count] = key;
+                bucket.rids[bucket.count] = rid;
+                bucket.count++;
+                if ((error = writeBucket(pid, bucket)) != 0) {
+                    return error;
+                }
+                entryCount++;
+                dirty = true;
+                return 0;
+            }
+            if (pid == directory[slot]) {
+                localDepth = bucket.localDepth;
+            }
+            for (int i = 0; i < bucket.count && !splittable; i++) {
+                splittable = ((hashKey(bucket.keys[i]) ^ h) & splitMask) != 0;
+            }
+            if (bucket.overflow == -1) {
+                break;
+            }
+            pid = bucket.overflow;
+        }
+
+        if (splittable && localDepth < MAX_GLOBAL_DEPTH) {
+            if ((error = splitBucket(slot)) != 0) {
+                return error;
+            }
+            continue;
+        }
+
+        // every key of the bucket hashes like the new one. chain a new page.
+        HashBucketPage page;
+        PageId newPid;
+        memset(&page, 0, sizeof(page));
+        page.localDepth = bucket.localDepth;
+        page.count = 1;
+        page.overflow = -1;
+        page.keys[0] = key;
+        page.rids[0] = rid;
+        if ((error = allocatePage(newPid)) != 0 || (error = writeBucket(newPid, page)) != 0) {
+            return error;
+        }
+        bucket.overflow = newPid;
+        if ((error = writeBucket(pid, bucket)) != 0) {
+            return error;
+        }
+        entryCount++;
+        dirty = true;
+        return 0;
+    }
+}
+
+/*
+ * Split the bucket the directory slot points to along hash bit localDepth.
+ * The entries whose bit is set move to a new bucket, and the directory
+ * slots that have the bit set and pointed to the old bucket point to the
+ * new one. The directory doubles first if the bucket uses all its bits.
+ */
+RC HashIndex::splitBucket(int slot)
+{
+    RC error;
+    PageId pid = directory[slot];
+    vector<long long> keys[2];
+    vector<RecordId> rids[2];
+    vector<PageId> spare;
+    HashBucketPage bucket;
+    int localDepth = -1;
+
+    for (PageId p = pid; p != -1; p = bucket.overflow) {
+        if ((error = readBucket(p, bucket)) != 0) {
+            return error;
+        }
+        if (localDepth < 0) {
+            localDepth = bucket.localDepth;
+        } else {
+            spare.push_back(p);
+        }
+        for (int i = 0; i < bucket.count; i++) {
+            int side = (hashKey(bucket.keys[i]) >> localDepth) & 1;
+            keys[side].push_back(bucket.keys[i]);
+            rids[side].push_back(bucket.rids[i]);
+        }
+    }
+
+    if (localDepth == globalDepth && (error = growDirectory()) != 0) {
+        return error;
+    }
+
+    PageId newPid;
+    if ((error = allocatePage(newPid)) != 0 ||
+        (error = writeChain(pid, localDepth + 1, keys[0], rids[0], spare)) != 0 ||
+        (error = writeChain(newPid, localDepth + 1, keys[1], rids[1], spare)) != 0) {
+        return error;
+    }
+    for (unsigned i = 0; i < spare.size(); i++) {
+        if ((error = freePage(spare[i])) != 0) {
+            return error;
+        }
+    }
+
+    for (unsigned i = 0; i < directory.size(); i++) {
+        if (directory[i] == pid && ((i >> localDepth) & 1)) {
+            directory[i] = newPid;
+        }
+    }
+    dirty = true;
+    return 0;
+}
+
+/*
+ * Write the entries of a bucket to the page pid and, for as many entries
+ * as do not fit there, to overflow pages taken from spare or allocated.
+ */
+RC HashIndex::writeChain(PageId pid, int localDepth, const vector<long long>& keys,
+                         const vector<RecordId>& rids, vector<PageId>& spare)
+{
+    RC error;
+    unsigned i = 0;
+    do {
+        HashBucketPage page;
+        memset(&page, 0, sizeof(page));
+        page.localDepth = localDepth;
+        page.overflow = -1;
+        for (; i < keys.size() && page.count < BUCKET_ENTRIES; i++, page.count++) {
+            page.keys[page.count] = keys[i];
+            page.rids[page.count] = rids[i];
+        }
+        PageId next = -1;
+        if (i < keys.size()) {
+            if (!spare.empty()) {
+                next = spare.back();
+                spare.pop_back();
+            } else if ((error = allocatePage(next)) != 0) {
+                return error;
+            }
+            page.overflow = next;
+        }
+        if ((error = writeBucket(pid, page)) != 0) {
+            return error;
+        }
+        pid = next;
+    } while (pid != -1);
+    return 0;
+}
+
+/*
+ * Double the directory. Slot i + 2^globalDepth points where slot i does.
+ */
+RC HashIndex::growDirectory()
+{
+    if (globalDepth == MAX_GLOBAL_DEPTH) {
+        return RC_NODE_FULL;
+    }
+    int size = directory.size();
+    directory.resize(2 * size);
+    for (int i = 0; i < size; i++) {
+        directory[size + i] = directory[i];
+    }
+    globalDepth++;
+    dirty = true;
+    return 0;
+}
+
+/*
+ * Remove the (key, RecordId) pair from the index. The last entry of its
+ * page takes its place, and an overflow page left empty is freed.
+ * @param key[IN] the key of the pair to remove
+ * @param rid[IN] the RecordId of the pair to remove
+ * @return error code. RC_NO_SUCH_RECORD if the pair is not in the index
+ */
+RC HashIndex::remove(long long key, const RecordId& rid)
+{
+    RC error;
+    PageId prevPid = -1;
+    HashBucketPage prev;
+    HashBucketPage bucket;
+
+    for (PageId pid = directory[hashKey(key) & ((1u << globalDepth) - 1)]; pid != -1;
+         prevPid = pid, prev = bucket, pid = bucket.overflow) {
+        if ((error = readBucket(pid, bucket)) != 0) {
+            return error;
+        }
+        for (int i = 0; i < bucket.count; i++) {
+            if (bucket.keys[i] != key || bucket.rids[i] != rid) {
+                continue;
+            }
+            bucket.count--;
+            bucket.keys[i] = bucket.keys[bucket.count];
+            bucket.rids[i] = bucket.rids[bucket.count];
+            if (bucket.count == 0 && prevPid != -1) {
+                prev.overflow = bucket.overflow;
+                if ((error = writeBucket(prevPid, prev)) != 0) {
+                    return error;
+                }
+                error = freePage(pid);
+            } else {
+                error = writeBucket(pid, bucket);
+            }
+            if (error == 0) {
+                entryCount--;
+                dirty = true;
+            }
+            return error;
+        }
+    }
+    return RC_NO_SUCH_RECORD;
+}
+
+/*
+ * Find the RecordIds of all entries with the given key.
+ * @param key[IN] the key to look up
+ * @param rids[OUT] the RecordIds found, appended in no particular order
+ * @return error code. 0 if no error, also if no entry has the key
+ */
+RC HashIndex::find(long long key, vector<RecordId>& rids)
+{
+    RC error;
+    HashBucketPage bucket;
+
+    for (PageId pid = directory[hashKey(key) & ((1u << globalDepth) - 1)]; pid != -1;
+         pid = bucket.overflow) {
+        if ((error = readBucket(pid, bucket)) != 0) {
+            return error;
+        }
+        for (int i = 0; i < bucket.count; i++) {
+            if (bucket.keys[i] == key) {
+                rids.push_back(bucket.rids[i]);
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * @return the number of entries in the index
+ */
+int HashIndex::getEntryCount() const
+{
+    return entryCount;
+}
+
+RC HashIndex::readBucket(PageId pid, HashBucketPage& bucket)
+{
+    RC error = pf.read(pid, &bucket);
+    if (error != 0) {
+        return error;
+    }
+    if (bucket.count < 0 || bucket.count > BUCKET_ENTRIES) {
+        return RC_INVALID_FILE_FORMAT;
+    }
+    return 0;
+}
+
+RC HashIndex::writeBucket(PageId pid, const HashBucketPage& bucket)
+{
+    return pf.write(pid, &bucket);
+}
+
+/*
+ * Take a page off the free list, or add one at the end of the file.
+ * A page added at the end is written right away, so that the next
+ * allocation does not hand it out again.
+ */
+RC HashIndex::allocatePage(PageId& pid)
+{
+    HashBucketPage page;
+    RC error;
+
+    if (freePid == -1) {
+        pid = pf.endPid();
+        memset(&page, 0, sizeof(page));
+        page.overflow = -1;
+        return writeBucket(pid, page);
+    }
+    if ((error = readBucket(freePid, page)) != 0) {
+        return error;
+    }
+    pid = freePid;
+    freePid = page.overflow;
+    dirty = true;
+    return 0;
+}
+
+/*
+ * Put a page that is no longer used on the free list.
+ */
+RC HashIndex::freePage(PageId pid)
+{
+    HashBucketPage page;
+    memset(&page, 0, sizeof(page));
+    page.overflow = freePid;
+    RC error = writeBucket(pid, page);
+    if (error == 0) {
+        freePid = pid;
+        dirty = true;
+    }
+    return error;
+}
@@ -0,0 +1,139 @@
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include "RecordFile.h"
+
+/**
+ * The first page of a hash index file. The directory of the index,
+ * 2^globalDepth bucket PageIds, is stored in the pages dirPids[0..dirPageCount).
+ */
+typedef struct {
+    int    magic;          // HashIndex::MAGIC
+    int    globalDepth;    // # hash bits the directory is indexed by
+    int    entryCount;     // # (key, rid) entries in the index
+    PageId freePid;        // the first page on the list of free pages, -1 if none
+    int    dirPageCount;   // # pages the directory takes
+    PageId dirPids[251];   // the pages of the directory
+} HashMetaPage;
+
+/**
+ * A page of the directory, holding HashIndex::DIR_ENTRIES bucket PageIds.
+ */
+typedef struct {
+    PageId buckets[PageFile::PAGE_SIZE / sizeof(PageId)];
+} HashDirPage;
+
+const int BUCKET_ENTRIES = 63;
+
+/**
+ * A bucket page. All keys in a bucket agree in their lowest localDepth
+ * hash bits. A bucket that cannot be split any further, because its keys
+ * all hash alike, goes on in a chain of overflow pages of the same layout.
+ * Free pages are chained through overflow as well.
+ */
+typedef struct {
+    int      localDepth;   // # hash bits all keys of the bucket agree in
+    int      count;        // # entries in the page
+    PageId   overflow;     // the next page of the bucket, -1 if none
+    int      unused[1];
+    long long keys[BUCKET_ENTRIES];
+    RecordId rids[BUCKET_ENTRIES];
+} HashBucketPage;
+
+/**
+ * HashIndex: an extendible hash index for equality lookups on 64-bit keys.
+ * An index on the key column stores the keys themselves. An index on the
+ * value column stores the hashValue() of every value instead, so the
+ * tuples it finds must be read to rule out other values with the same hash.
+ * The directory is read into memory on open, so a lookup reads the
+ * one bucket page its key hashes to, plus the overflow pages of the
+ * bucket if it has any, however many entries the index holds.
+ * A full bucket is split in two along one more hash bit, doubling the
+ * directory when the bucket already uses all bits of it. Buckets are
+ * not merged when entries are removed.
+ *
+ * Unlike BTreeIndex, a HashIndex must not be used by several threads
+ * at the same time.
+ */
+class HashIndex {
+  public:
+    static const int MAGIC = 0x38444948;   // "HID8"
+    static const int DIR_ENTRIES = PageFile::PAGE_SIZE / sizeof(PageId);
+    static const int MAX_GLOBAL_DEPTH = 15; // the directory fits in dirPids
+
+    HashIndex();
+
+   /**
+    * @return the 64-bit key the value is stored under in an index on values
+    */
+    static long long hashValue(const std::string& value);
+
+   /**
+    * Open the index file in read or write mode.
+    * Under 'w' mode, the index file is created if it does not exist.
+    * @param indexname[IN] the name of the index file
+    * @param mode[IN] 'r' for read, 'w' for write
+    * @return error code. 0 if no error
+    */
+    RC open(const std::string& indexname, char mode);
+
+   /**
+    * Write the directory back if it changed and close the index file.
+    * @return error code. 0 if no error
+    */
+    RC close();
+
+   /**
+    * Insert (key, RecordId) pair to the index.
+    * @param key[IN] the key for the value inserted into the index
+    * @param rid[IN] the RecordId for the record being inserted into the index
+    * @return error code. 0 if no error
+    */
+    RC insert(long long key, const RecordId& rid);
+
+   /**
+    * Remove the (key, RecordId) pair from the index.
+    * @param key[IN] the key of the pair to remove
+    * @param rid[IN] the RecordId of the pair to remove
+    * @return error code. RC_NO_SUCH_RECORD if the pair is not in the index
+    */
+    RC remove(long long key, const RecordId& rid);
+
+   /**
+    * Find the RecordIds of all entries with the given key.
+    * @param key[IN] the key to look up
+    * @param rids[OUT] the RecordIds found, appended in no particular order
+    * @return error code. 0 if no error, also if no entry has the key
+    */
+    RC find(long long key, std::vector<RecordId>& rids);
+
+   /**
+    * @return the number of entries in the index
+    */
+    int getEntryCount() const;
+
+  private:
+    RC readBucket(PageId pid, HashBucketPage& bucket);
+    RC writeBucket(PageId pid, const HashBucketPage& bucket);
+    RC writeChain(PageId pid, int localDepth, const std::vector<long long>& keys,
+                  const std::vector<RecordId>& rids, std::vector<PageId>& spare);
+    RC splitBucket(int slot);
+    RC growDirectory();
+    RC writeDirectory();
+    RC allocatePage(PageId& pid);
+    RC freePage(PageId pid);
+
+    PageFile pf;                  /// the PageFile used to store the index
+    int      globalDepth;         /// # hash bits the directory is indexed by
+    int      entryCount;          /// # entries in the index
+    PageId   freePid;             /// the first free page, -1 if none
+    std::vector<PageId> directory; /// the bucket of every hash value
+    std::vector<PageId> dirPids;  /// the pages the directory is stored in
+    bool     dirty;               /// whether the directory must be written
+};
+
+#endif /* HASHINDEX_H */
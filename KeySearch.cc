@@ -0,0 +1,203 @@
+#include "KeySearch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KEYSEARCH_X86
+#endif
+
+// arrays longer than this are binary searched even when vector
+// compares are available
+static const int LINEAR_SEARCH_MAX = 128;
+
+//
+// branchless binary search. the loop body has no data dependent branch,
+// so the only cost of a probe is its load.
+//
+
+static int lowerBoundBinary(const int* keys, int n, int key)
+{
+    if (n == 0) {
+        return 0;
+    }
+    const int* base = keys;
+    while (n > 1) {
+        int half = n / 2;
+        base = (base[half] < key) ? base + half : base;
+        n -= half;
+    }
+    return (base - keys) + (*base < key);
+}
+
+static int upperBoundBinary(const int* keys, int n, int key)
+{
+    if (n == 0) {
+        return 0;
+    }
+    const int* base = keys;
+    while (n > 1) {
+        int half = n / 2;
+        base = (base[half] <= key) ? base + half : base;
+        n -= half;
+    }
+    return (base - keys) + (*base <= key);
+}
+
+#ifdef KEYSEARCH_X86
+
+//
+// vector kernels. since the keys are sorted, the position of the first
+// key >= key is the number of keys < key, which is counted with one
+// compare and one movemask per vector of keys.
+//
+
+__attribute__((target("avx2")))
+static int lowerBoundAvx2(const int* keys, int n, int key)
+{
+    __m256i k = _mm256_set1_epi32(key);
+    int count = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (keys + i));
+        __m256i lt = _mm256_cmpgt_epi32(k, v);
+        count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(lt)));
+    }
+    for (; i < n; i++) {
+        count += (keys[i] < key);
+    }
+    return count;
+}
+
+__attribute__((target("avx2")))
+static int upperBoundAvx2(const int* keys, int n, int key)
+{
+    __m256i k = _mm256_set1_epi32(key);
+    int count = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (keys + i));
+        __m256i gt = _mm256_cmpgt_epi32(v, k);
+        count += 8 - __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(gt)));
+    }
+    for (; i < n; i++) {
+        count += (keys[i] <= key);
+    }
+    return count;
+}
+
+static int lowerBoundSse2(const int* keys, int n, int key)
+{
+    __m128i k = _mm_set1_epi32(key);
+    int count = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (keys + i));
+        __m128i lt = _mm_cmpgt_epi32(k, v);
+        count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(lt)));
+    }
+    for (; i < n; i++) {
+        count += (keys[i] < key);
+    }
+    return count;
+}
+
+static int upperBoundSse2(const int* keys, int n, int key)
+{
+    __m128i k = _mm_set1_epi32(key);
+    int count = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (keys + i));
+        __m128i gt = _mm_cmpgt_epi32(v, k);
+        count += 4 - __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(gt)));
+    }
+    for (; i < n; i++) {
+        count += (keys[i] <= key);
+    }
+    return count;
+}
+
+#endif /* KEYSEARCH_X86 */
+
+typedef int (*SearchKernel)(const int* keys, int n, int key);
+
+typedef struct {
+    SearchKernel lowerBound;
+    SearchKernel upperBound;
+} SearchKernels;
+
+static SearchKernels selectKernels()
+{
+    SearchKernels kernels = { lowerBoundBinary, upperBoundBinary };
+#ifdef KEYSEARCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.lowerBound = lowerBoundAvx2;
+        kernels.upperBound = upperBoundAvx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        kernels.lowerBound = lowerBoundSse2;
+        kernels.upperBound = upperBoundSse2;
+    }
+#endif
+    return kernels;
+}
+
+static const SearchKernels kernels = selectKernels();
+
+int keyLowerBound(const int* keys, int n, int key)
+{
+    if (n > LINEAR_SEARCH_MAX) {
+        return lowerBoundBinary(keys, n, key);
+    }
+    return kernels.lowerBound(keys, n, key);
+}
+
+int keyUpperBound(const int* keys, int n, int key)
+{
+    if (n > LINEAR_SEARCH_MAX) {
+        return upperBoundBinary(keys, n, key);
+    }
+    return kernels.upperBound(keys, n, key);
+}
+
+//
+// interpolation. the position of a key is predicted from a straight line
+// through the first and the last key. the prediction is monotonic in the
+// key, so if every key of the array is predicted within error of its
+// position, the first key >= any search key is within error + 1 of the
+// prediction for it.
+//
+
+int keyInterpolate(const int* keys, int n, int key)
+{
+    if (n == 0 || key <= keys[0]) {
+        return 0;
+    }
+    if (key > keys[n - 1]) {
+        return n;
+    }
+    long long span = (long long) keys[n - 1] - keys[0];
+    return (int) (((long long) key - keys[0]) * (n - 1) / span);
+}
+
+int keyModelError(const int* keys, int n)
+{
+    int error = 0;
+    for (int i = 0; i < n; i++) {
+        int distance = keyInterpolate(keys, n, keys[i]) - i;
+        if (distance < 0) {
+            distance = -distance;
+        }
+        if (distance > error) {
+            error = distance;
+        }
+    }
+    return error;
+}
+
+int keyLowerBoundNear(const int* keys, int n, int key, int error)
+{
+    int guess = keyInterpolate(keys, n, key);
+    int lo = guess - error > 0 ? guess - error : 0;
+    int hi = guess + error + 1 < n ? guess + error + 1 : n;
+    return lo + keyLowerBound(keys + lo, hi - lo, key);
+}
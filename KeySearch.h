@@ -0,0 +1,66 @@
+#ifndef KEYSEARCH_H
+#define KEYSEARCH_H
+
+/**
+ * Search kernels for the sorted key arrays inside B+tree nodes.
+ * On x86 the kernels compare a whole vector of keys at a time (AVX2 or
+ * SSE2, chosen at run time from the CPU features); elsewhere, and for
+ * arrays too long for a linear scan to pay off, a branchless binary
+ * search is used. For arrays whose keys are spread evenly, the position
+ * of a key can also be predicted by interpolation and then searched
+ * for only within the error bound of the prediction.
+ */
+
+/**
+ * Return the position of the first key in keys[0..n) that is not smaller
+ * than key, i.e. the number of keys smaller than key.
+ * @param keys[IN] the sorted key array
+ * @param n[IN] the number of keys in the array
+ * @param key[IN] the key to search for
+ * @return the position of the first key >= key (n if there is none)
+ */
+int keyLowerBound(const int* keys, int n, int key);
+
+/**
+ * Return the position of the first key in keys[0..n) that is larger
+ * than key, i.e. the number of keys smaller than or equal to key.
+ * @param keys[IN] the sorted key array
+ * @param n[IN] the number of keys in the array
+ * @param key[IN] the key to search for
+ * @return the position of the first key > key (n if there is none)
+ */
+int keyUpperBound(const int* keys, int n, int key);
+
+/**
+ * Predict the position of key in keys[0..n) by linear interpolation
+ * between the first and the last key of the array.
+ * @param keys[IN] the sorted key array
+ * @param n[IN] the number of keys in the array
+ * @param key[IN] the key to predict the position of
+ * @return the predicted position, between 0 and n
+ */
+int keyInterpolate(const int* keys, int n, int key);
+
+/**
+ * Return how far keyInterpolate() is off at most for the keys of
+ * the array, i.e. the error bound of the interpolation model.
+ * @param keys[IN] the sorted key array
+ * @param n[IN] the number of keys in the array
+ * @return the largest distance between the predicted and the real
+ *         position of a key of the array
+ */
+int keyModelError(const int* keys, int n);
+
+/**
+ * Like keyLowerBound(), but only search the positions within error of
+ * the one keyInterpolate() predicts. error must be keyModelError(keys, n)
+ * or larger.
+ * @param keys[IN] the sorted key array
+ * @param n[IN] the number of keys in the array
+ * @param key[IN] the key to search for
+ * @param error[IN] the error bound of the interpolation model
+ * @return the position of the first key >= key (n if there is none)
+ */
+int keyLowerBoundNear(const int* keys, int n, int key, int error);
+
+#endif /* KEYSEARCH_H */
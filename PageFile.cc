@@ -10,17 +10,23 @@
 #include "Bruinbase.h"
 #include "PageFile.h"
 #include <cstring>
+#include <mutex>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 using std::string;
 
-int PageFile::readCount = 0;
-int PageFile::writeCount = 0;
-int PageFile::cacheClock = 1;
+std::atomic<int> PageFile::readCount(0);
+std::atomic<int> PageFile::writeCount(0);
+std::atomic<int> PageFile::cacheClock(1);
 struct PageFile::cacheStruct PageFile::readCache[PageFile::CACHE_COUNT];
 
+// serializes the changes to the read cache and the end pids of the files,
+// so that several threads can read and write pages at the same time.
+// cache hits take no lock, and the disk i/o runs outside of it.
+static std::mutex cacheMutex;
+
 PageFile::PageFile() 
 { 
   fd = -1; 
@@ -76,11 +82,10 @@ RC PageFile::close()
   if (::close(fd) < 0) return RC_FILE_CLOSE_FAILED;
 
   // evict all cached pages for this file
+  std::lock_guard<std::mutex> guard(cacheMutex);
   for (int i = 0; i < CACHE_COUNT; i++) {
     if (readCache[i].fd == fd && readCache[i].lastAccessed != 0) {
-       readCache[i].fd = 0;
-       readCache[i].pid = 0;
-       readCache[i].lastAccessed = 0;
+       clearSlot(readCache[i]);
     }
   }
 
@@ -102,22 +107,18 @@ RC PageFile::seek(PageId pid) const
 
 RC PageFile::write(PageId pid, const void* buffer)
 {
-  RC rc;
   if (pid < 0) return RC_INVALID_PID; 
 
-  // seek to the location of the page
-  if ((rc = seek(pid)) < 0) return rc;
-
   // write the buffer to the disk page
-  if (::write(fd, buffer, PAGE_SIZE) < 0) return RC_FILE_WRITE_FAILED;
+  if (::pwrite(fd, buffer, PAGE_SIZE, (off_t) pid * PAGE_SIZE) < 0) return RC_FILE_WRITE_FAILED;
+
+  std::lock_guard<std::mutex> guard(cacheMutex);
 
   // if the page is in read cache, invalidate it
   for (int i = 0; i < CACHE_COUNT; i++) {
     if (readCache[i].fd == fd && readCache[i].pid == pid &&
         readCache[i].lastAccessed != 0) {
-       readCache[i].fd = 0;
-       readCache[i].pid = 0;
-       readCache[i].lastAccessed = 0;
+       clearSlot(readCache[i]);
        break;
     }
   }
@@ -133,25 +134,36 @@ RC PageFile::write(PageId pid, const void* buffer)
 
 RC PageFile::read(PageId pid, void* buffer) const
 {
-  RC rc;
-
   if (pid < 0 || pid >= epid) return RC_INVALID_PID; 
 
-  //
   // if the page is in cache, read it from there
-  //
+  if (readCached(pid, buffer)) return 0;
+
+  int writes = writeCount;
+
+  // read the page
+  if (::pread(fd, buffer, PAGE_SIZE, (off_t) pid * PAGE_SIZE) < 0) {
+    return RC_FILE_READ_FAILED;
+  }
+
+  // increase the page read count
+  readCount++;
+
+  std::lock_guard<std::mutex> guard(cacheMutex);
+
+  // cache the page unless a page was written while it was being read,
+  // in which case the copy read may already be stale
+  if (writes != writeCount) return 0;
+
+  // another thread may have cached the page meanwhile. keep a single
+  // copy of it, since write() only clears the first copy it finds.
   for (int i = 0; i < CACHE_COUNT; i++) {
-    if (readCache[i].fd == fd && readCache[i].pid == pid && 
+    if (readCache[i].fd == fd && readCache[i].pid == pid &&
         readCache[i].lastAccessed != 0) {
-       memcpy(buffer, readCache[i].buffer, PAGE_SIZE);
-       readCache[i].lastAccessed = ++cacheClock;
-       return 0;
+      return 0;
     }
   }
 
-  // seek to the page
-  if ((rc = seek(pid)) < 0) return rc;
-  
   // find the cache slot to evict
   int toEvict = 0; 
   for (int i = 0; i < CACHE_COUNT; i++) {
@@ -163,18 +175,63 @@ RC PageFile::read(PageId pid, void* buffer) const
       toEvict = i;
     }
   }
-  readCache[toEvict].fd = fd;
-  readCache[toEvict].pid = pid;
-  readCache[toEvict].lastAccessed = ++cacheClock;
- 
-  // read the page to cache first and copy it to the buffer
-  if (::read(fd, readCache[toEvict].buffer, PAGE_SIZE) < 0) {
-    return RC_FILE_READ_FAILED;
-  }
-  memcpy(buffer, readCache[toEvict].buffer, PAGE_SIZE);
-
-  // increase the page read count
-  readCount++;
+  cacheStruct& slot = readCache[toEvict];
+  unsigned version = slot.version.load(std::memory_order_relaxed);
+  slot.version.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.fd = fd;
+  slot.pid = pid;
+  slot.lastAccessed = ++cacheClock;
+  memcpy(slot.buffer, buffer, PAGE_SIZE);
+  slot.version.store(version + 2, std::memory_order_release);
 
   return 0;
 }
+
+/*
+ * Copy the page pid out of the read cache, if it is there, without taking
+ * the cache lock. The copy is only used if its slot was not changed
+ * meanwhile.
+ * @return whether the page was in the cache
+ */
+bool PageFile::readCached(PageId pid, void* buffer) const
+{
+  for (int i = 0; i < CACHE_COUNT; i++) {
+    cacheStruct& slot = readCache[i];
+    unsigned version = slot.version.load(std::memory_order_acquire);
+    if ((version & 1) != 0 || slot.fd.load(std::memory_order_relaxed) != fd ||
+        slot.pid.load(std::memory_order_relaxed) != pid) {
+      continue;
+    }
+    int lastAccessed = slot.lastAccessed.load(std::memory_order_relaxed);
+    if (lastAccessed == 0) continue;
+    memcpy(buffer, slot.buffer, PAGE_SIZE);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.version.load(std::memory_order_relaxed) != version) {
+      return false;
+    }
+
+    // make it the most recently used page. a page that already is needs
+    // no new tick, so lookups hitting the same pages do not all bump the
+    // clock. the tick is lost if the slot is changed meanwhile.
+    if (lastAccessed != cacheClock.load(std::memory_order_relaxed)) {
+      slot.lastAccessed.compare_exchange_strong(lastAccessed, ++cacheClock);
+    }
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Empty a slot of the read cache. The caller holds the cache lock.
+ */
+void PageFile::clearSlot(cacheStruct& slot)
+{
+  unsigned version = slot.version.load(std::memory_order_relaxed);
+  slot.version.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.fd = 0;
+  slot.pid = 0;
+  slot.lastAccessed = 0;
+  slot.version.store(version + 2, std::memory_order_release);
+}
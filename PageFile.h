@@ -10,6 +10,7 @@
 #ifndef PAGEFILE_H
 #define PAGEFILE_H
 
+#include <atomic>
 #include <string>
 #include "Bruinbase.h"
 
@@ -87,26 +88,32 @@ class PageFile {
 
  private:
   int     fd;     // file descriptor of the associated unix file
-  PageId  epid;   // (last page id + 1) of the file
+  std::atomic<PageId> epid;   // (last page id + 1) of the file
 
   //
   // the following set of members implement LRU caching 
   //
   static const int CACHE_COUNT = 10;
 
-  static int cacheClock; // clock tick counter for LRU policy
+  static std::atomic<int> cacheClock; // clock tick counter for LRU policy
 
-  // the actual cache data structure
+  // the actual cache data structure. a slot is only changed under the
+  // cache lock, with its version odd meanwhile, so that a cache hit can
+  // copy the page out without the lock and check the version after.
   static struct cacheStruct {
-    int    fd;              // file id of the cached page
-    PageId pid;             // page id of the cached page
-    int    lastAccessed;    // the last time the cached page was accessed
+    std::atomic<unsigned> version;      // even when the slot is not being changed
+    std::atomic<int>      fd;           // file id of the cached page
+    std::atomic<PageId>   pid;          // page id of the cached page
+    std::atomic<int>      lastAccessed; // the last time the cached page was accessed
                             //   (lastAccessed == 0) means that the buffer is empty
     char buffer[PAGE_SIZE]; // the buffer used for caching
   } readCache[CACHE_COUNT];
 
-  static int readCount;  // total # of page reads 
-  static int writeCount; // total # of page writes 
+  static std::atomic<int> readCount;  // total # of page reads 
+  static std::atomic<int> writeCount; // total # of page writes 
+
+  static void clearSlot(cacheStruct& slot);
+  bool readCached(PageId pid, void* buffer) const;
 };
   
 #endif // PAGEFILE_H
@@ -13,6 +13,12 @@
 
 using std::string;
 
+// the slots of a page and its bitmap of removed slots must fit in the page
+static_assert(RecordFile::RECORDS_PER_PAGE <= 32 &&
+              sizeof(int) + RecordFile::RECORDS_PER_PAGE * (sizeof(int) + RecordFile::MAX_VALUE_LENGTH)
+              <= PageFile::PAGE_SIZE - sizeof(int),
+              "no room for the removed slot bitmap");
+
 //
 // helper functions for page manipultation
 //
@@ -32,6 +38,12 @@ static int getRecordCount(const char* page);
 // update # records stored in the page
 static void setRecordCount(char* page, int count);
 
+// check whether the record in the n'th slot of the page was removed
+static bool isRemoved(const char* page, int n);
+
+// mark the record in the n'th slot of the page as removed
+static void setRemoved(char* page, int n);
+
 
 //
 // helper functions for RecordId manipulation
@@ -177,6 +189,7 @@ RC RecordFile::read(const RecordId& rid, int& key, string& value) const
   
   // read the page containing the record
   if ((rc = pf.read(rid.pid, page)) < 0) return rc;
+  if (isRemoved(page, rid.sid)) return RC_NO_SUCH_RECORD;
 
   // read the record from the slot in the page
   readSlot(page, rid.sid, key, value);
@@ -184,6 +197,45 @@ RC RecordFile::read(const RecordId& rid, int& key, string& value) const
   return 0;
 }
 
+RC RecordFile::readBatch(RecordId& rid, RecordBatch& batch) const
+{
+  RC   rc;
+  int  npages = 0;
+
+  batch.count = 0;
+  if (rid.pid < 0 || rid.sid < 0 || rid.sid >= RECORDS_PER_PAGE) return RC_INVALID_RID;
+
+  while (batch.count < BATCH_SIZE && npages < BATCH_PAGES && rid < erid) {
+    // read the page containing rid into the next page copy of the batch
+    char* page = batch.pages[npages++];
+    if ((rc = pf.read(rid.pid, page)) < 0) return rc;
+
+    // the last page of the file may be partially filled
+    int last = (rid.pid == erid.pid) ? erid.sid : RECORDS_PER_PAGE;
+
+    // take every remaining slot in the page that still fits in the batch
+    for (; rid.sid < last && batch.count < BATCH_SIZE; rid.sid++) {
+      if (isRemoved(page, rid.sid)) continue;
+
+      char* ptr = slotPtr(page, rid.sid);
+      int   n   = batch.count++;
+
+      memcpy(&batch.keys[n], ptr, sizeof(int));
+      batch.rids[n] = rid;
+      batch.values[n] = ptr + sizeof(int);
+      batch.valueLengths[n] = strnlen(ptr + sizeof(int), MAX_VALUE_LENGTH);
+    }
+
+    // if the end of a page is reached, move to the next page
+    if (rid.sid >= RECORDS_PER_PAGE) {
+      rid.pid++;
+      rid.sid = 0;
+    }
+  }
+
+  return 0;
+}
+
 RC RecordFile::append(int key, const std::string& value, RecordId& rid)
 {
   RC   rc;
@@ -218,6 +270,22 @@ RC RecordFile::append(int key, const std::string& value, RecordId& rid)
   return 0;
 }
 
+RC RecordFile::remove(const RecordId& rid)
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  // check whether the rid is in the valid range
+  if (rid.pid < 0 || rid.sid < 0 || rid.sid >= RECORDS_PER_PAGE) return RC_INVALID_RID;
+  if (rid >= erid) return RC_INVALID_RID;
+
+  if ((rc = pf.read(rid.pid, page)) < 0) return rc;
+  if (isRemoved(page, rid.sid)) return RC_NO_SUCH_RECORD;
+
+  setRemoved(page, rid.sid);
+  return pf.write(rid.pid, page);
+}
+
 const RecordId& RecordFile::endRid() const
 {
   return erid;
@@ -238,6 +306,23 @@ static void setRecordCount(char* page, int count)
   memcpy(page, &count, sizeof(int));
 }
 
+static bool isRemoved(const char* page, int n)
+{
+  // the last four bytes of a page hold a bitmap of the removed slots.
+  // pages are zeroed when they are created, so no slot starts out removed.
+  unsigned int removed;
+  memcpy(&removed, page + PageFile::PAGE_SIZE - sizeof(int), sizeof(int));
+  return (removed >> n) & 1;
+}
+
+static void setRemoved(char* page, int n)
+{
+  unsigned int removed;
+  memcpy(&removed, page + PageFile::PAGE_SIZE - sizeof(int), sizeof(int));
+  removed |= 1u << n;
+  memcpy(page + PageFile::PAGE_SIZE - sizeof(int), &removed, sizeof(int));
+}
+
 static char* slotPtr(char* page, int n) 
 {
   // compute the location of the n'th slot in a page.
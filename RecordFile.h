@@ -38,6 +38,8 @@ bool operator<= (const RecordId& r1, const RecordId& r2);
 bool operator== (const RecordId& r1, const RecordId& r2);
 bool operator!= (const RecordId& r1, const RecordId& r2);
 
+struct RecordBatch;
+
 /**
  * read/write a record to a file
  */
@@ -52,6 +54,13 @@ class RecordFile {
     // Note that we subtract sizeof(int) from PAGE_SIZE because the first
     // four bytes in the page is used to store # records in the page.
 
+  // maximum number of records returned by one readBatch() call
+  static const int BATCH_SIZE = 1024;
+
+  // number of page copies a RecordBatch needs to hold BATCH_SIZE records
+  // starting from an arbitrary slot
+  static const int BATCH_PAGES = BATCH_SIZE / RECORDS_PER_PAGE + 2;
+
   RecordFile();
   RecordFile(const std::string& filename, char mode);
   
@@ -75,10 +84,22 @@ class RecordFile {
    * @param rid[IN] the id of the record to read
    * @param key[OUT] the record key
    * @param value[OUT] the record valu
-   * @return error code. 0 if no error
+   * @return error code. RC_NO_SUCH_RECORD if the record was removed
    */
   RC read(const RecordId& rid, int& key, std::string& value) const;
 
+  /**
+   * read up to BATCH_SIZE consecutive records starting at rid into batch.
+   * removed records are skipped. every page is read only once, and the values are not copied out of
+   * the page: batch.values[i] points into the page copy kept in the batch.
+   * rid is advanced past the last record read. batch.count is 0 when
+   * rid is already at endRid().
+   * @param rid[IN/OUT] the id of the first record to read
+   * @param batch[OUT] the records read
+   * @return error code. 0 if no error
+   */
+  RC readBatch(RecordId& rid, RecordBatch& batch) const;
+
   /**
    * append a new record at the end of the file.
    * note that RecordFile does not have write() function.
@@ -90,6 +111,15 @@ class RecordFile {
    */
   RC append(int key, const std::string& value, RecordId& rid);
 
+  /**
+   * remove a record from the file. the slot of the record is marked
+   * as removed in its page, which costs one page read and one page
+   * write. the slot is not reused, so the other record ids stay valid.
+   * @param rid[IN] the id of the record to remove
+   * @return error code. RC_NO_SUCH_RECORD if the record was removed already
+   */
+  RC remove(const RecordId& rid);
+
   /**
    * note the +1 part. The rid of the last record is endRid()-1.
    * @return (last record id + 1) of the RecordFile
@@ -101,4 +131,19 @@ class RecordFile {
   RecordId erid;   // the last record id of the file + 1
 };
 
+/**
+ * a batch of consecutive records filled by RecordFile::readBatch().
+ * the record fields are kept in separate arrays so that predicates can be
+ * evaluated over a whole batch in a tight loop.
+ * the value pointers stay valid until the batch is filled again.
+ */
+struct RecordBatch {
+  int         count;                                  // # records in the batch
+  int         keys[RecordFile::BATCH_SIZE];           // record keys
+  RecordId    rids[RecordFile::BATCH_SIZE];           // record ids
+  const char* values[RecordFile::BATCH_SIZE];         // record values
+  int         valueLengths[RecordFile::BATCH_SIZE];   // strlen() of values
+  char        pages[RecordFile::BATCH_PAGES][PageFile::PAGE_SIZE];
+};
+
 #endif // RECORDFILE_H
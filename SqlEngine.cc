@@ -13,9 +13,16 @@
 #include <climits>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <set>
 #include "Bruinbase.h"
 #include "SqlEngine.h"
 #include "BTreeIndex.h"
+#include "HashIndex.h"
+#include "StringIndex.h"
+#include "FrozenTable.h"
+#include "ExternalSort.h"
+#include <unistd.h>
 
 using namespace std;
 
@@ -23,6 +30,453 @@ using namespace std;
 extern FILE* sqlin;
 int sqlparse(void);
 
+// narrow the selection vector sel[0..n) of a record batch down to the
+// entries that satisfy the condition. each comparator gets its own loop so
+// that the loop body is a single compare without branches on comp.
+// return the number of entries left in sel.
+static int filterKeys(const int* keys, int* sel, int n, SelCond::Comparator comp, int v)
+{
+  int m = 0;
+  switch (comp) {
+  case SelCond::EQ:
+    for (int i = 0; i < n; i++) { sel[m] = sel[i]; m += (keys[sel[i]] == v); }
+    break;
+  case SelCond::NE:
+    for (int i = 0; i < n; i++) { sel[m] = sel[i]; m += (keys[sel[i]] != v); }
+    break;
+  case SelCond::GT:
+    for (int i = 0; i < n; i++) { sel[m] = sel[i]; m += (keys[sel[i]] > v); }
+    break;
+  case SelCond::LT:
+    for (int i = 0; i < n; i++) { sel[m] = sel[i]; m += (keys[sel[i]] < v); }
+    break;
+  case SelCond::GE:
+    for (int i = 0; i < n; i++) { sel[m] = sel[i]; m += (keys[sel[i]] >= v); }
+    break;
+  case SelCond::LE:
+    for (int i = 0; i < n; i++) { sel[m] = sel[i]; m += (keys[sel[i]] <= v); }
+    break;
+  }
+  return m;
+}
+
+static int filterValues(const char* const* values, int* sel, int n, SelCond::Comparator comp, const char* v)
+{
+  int m = 0;
+  for (int i = 0; i < n; i++) {
+    int  diff = strcmp(values[sel[i]], v);
+    bool keep = false;
+    switch (comp) {
+    case SelCond::EQ: keep = (diff == 0); break;
+    case SelCond::NE: keep = (diff != 0); break;
+    case SelCond::GT: keep = (diff > 0);  break;
+    case SelCond::LT: keep = (diff < 0);  break;
+    case SelCond::GE: keep = (diff >= 0); break;
+    case SelCond::LE: keep = (diff <= 0); break;
+    }
+    sel[m] = sel[i];
+    m += keep;
+  }
+  return m;
+}
+
+
+// check whether the comparison with the outcome diff (as of strcmp) holds
+static bool compMet(SelCond::Comparator comp, int diff)
+{
+  switch (comp) {
+  case SelCond::EQ: return diff == 0;
+  case SelCond::NE: return diff != 0;
+  case SelCond::GT: return diff > 0;
+  case SelCond::LT: return diff < 0;
+  case SelCond::GE: return diff >= 0;
+  case SelCond::LE: return diff <= 0;
+  }
+  return false;
+}
+
+// check whether the tuple (key, value) meets every condition
+static bool checkConds(const vector<SelCond>& cond, int key, const char* value)
+{
+  for (unsigned i = 0; i < cond.size(); i++) {
+    int diff;
+    if (cond[i].attr == 1) {
+      int v = atoi(cond[i].value);
+      diff = (key > v) - (key < v);
+    } else {
+      diff = strcmp(value, cond[i].value);
+    }
+    if (!compMet(cond[i].comp, diff)) return false;
+  }
+  return true;
+}
+
+// compare a value with v as strcmp does, knowing only the prefix of the
+// value that a covering index keeps. return false if the prefix is not
+// enough to tell.
+static bool comparePrefix(const IndexValue& value, const char* v, int& diff)
+{
+  switch (value.state) {
+  case VALUE_COMPLETE:
+    diff = strcmp(value.prefix, v);
+    return true;
+  case VALUE_TRUNCATED:
+    // the value goes on behind its prefix, so it is greater than a v
+    // that ends where the prefix does
+    diff = strncmp(value.prefix, v, value.length);
+    if (diff == 0 && strlen(v) == (size_t) value.length) diff = 1;
+    return diff != 0;
+  }
+  return false;
+}
+
+// check whether the tuple meets every condition, knowing its key and the
+// prefix of its value that a covering index keeps. return 1 if it does,
+// 0 if it does not, and -1 if the value must be read to tell.
+static int checkCondsPrefix(const vector<SelCond>& cond, int key, const IndexValue& value)
+{
+  bool unsure = false;
+  for (unsigned i = 0; i < cond.size(); i++) {
+    int diff;
+    if (cond[i].attr == 1) {
+      int v = atoi(cond[i].value);
+      diff = (key > v) - (key < v);
+    } else if (!comparePrefix(value, cond[i].value, diff)) {
+      unsure = true;
+      continue;
+    }
+    if (!compMet(cond[i].comp, diff)) return 0;
+  }
+  return unsure ? -1 : 1;
+}
+
+// compute the smallest range [lo, hi] of keys allowed by the key conditions.
+// return false if no key can meet the conditions.
+static bool keyRange(const vector<SelCond>& cond, int& lo, int& hi)
+{
+  long long l = INT_MIN, h = INT_MAX;
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr != 1) continue;
+    long long v = atoi(cond[i].value);
+    switch (cond[i].comp) {
+    case SelCond::EQ: l = max(l, v);     h = min(h, v); break;
+    case SelCond::GT: l = max(l, v + 1); break;
+    case SelCond::GE: l = max(l, v);     break;
+    case SelCond::LT: h = min(h, v - 1); break;
+    case SelCond::LE: h = min(h, v);     break;
+    case SelCond::NE: break;
+    }
+  }
+  if (l > h) return false;
+  lo = l;
+  hi = h;
+  return true;
+}
+
+// run a SELECT against the frozen snapshot of a table
+static RC selectFrozen(int attr, const FrozenTable& ft, const vector<SelCond>& cond)
+{
+  int lo, hi;
+  int count = 0;
+
+  if (keyRange(cond, lo, hi)) {
+    FrozenCursor cursor;
+    int          key;
+    const char*  value;
+    int          length;
+
+    ft.locate(lo, cursor);
+    while (ft.readForward(cursor, key, value, length) == 0 && key <= hi) {
+      if (!checkConds(cond, key, value)) continue;
+      count++;
+
+      switch (attr) {
+      case 1:  // SELECT key
+        fprintf(stdout, "%d\n", key);
+        break;
+      case 2:  // SELECT value
+        fprintf(stdout, "%s\n", value);
+        break;
+      case 3:  // SELECT *
+        fprintf(stdout, "%d '%s'\n", key, value);
+        break;
+      }
+    }
+  }
+
+  // print matching tuple count if "select count(*)"
+  if (attr == 4) {
+    fprintf(stdout, "%d\n", count);
+  }
+  return 0;
+}
+
+// find the key that an EQ condition on the key asks for.
+// return false if there is no such condition.
+static bool keyEquals(const vector<SelCond>& cond, int& key)
+{
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 1 && cond[i].comp == SelCond::EQ) {
+      key = atoi(cond[i].value);
+      return true;
+    }
+  }
+  return false;
+}
+
+// find the value that an EQ condition on the value asks for.
+// return false if there is no such condition.
+static bool valueEquals(const vector<SelCond>& cond, string& value)
+{
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 2 && cond[i].comp == SelCond::EQ) {
+      value = cond[i].value;
+      return true;
+    }
+  }
+  return false;
+}
+
+// run a SELECT with an EQ condition through a hash index of the table,
+// hashKey being the key of the index the condition asks for. the table
+// file is read, in the order of the RecordIds, only for the tuples whose
+// value is needed or whose key no condition gives. an index on the value
+// has a value condition to check, which rules out hash collisions.
+static RC selectHash(int attr, const string& table, RecordFile& rf,
+                     HashIndex& hi, long long hashKey, const vector<SelCond>& cond)
+{
+  RC   rc;
+  int  count = 0;
+  int  eqKey = 0;
+  bool needValue = (attr == 2 || attr == 3) || !keyEquals(cond, eqKey);
+  vector<RecordId> rids;
+
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 2) needValue = true;
+  }
+
+  if ((rc = hi.find(hashKey, rids)) < 0) {
+    fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+    return rc;
+  }
+  sort(rids.begin(), rids.end());
+
+  for (unsigned i = 0; i < rids.size(); i++) {
+    int    key = eqKey;
+    string value;
+    if (needValue && (rc = rf.read(rids[i], key, value)) < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      return rc;
+    }
+    if (!checkConds(cond, key, value.c_str())) continue;
+    count++;
+
+    switch (attr) {
+    case 1:  // SELECT key
+      fprintf(stdout, "%d\n", key);
+      break;
+    case 2:  // SELECT value
+      fprintf(stdout, "%s\n", value.c_str());
+      break;
+    case 3:  // SELECT *
+      fprintf(stdout, "%d '%s'\n", key, value.c_str());
+      break;
+    }
+  }
+
+  // print matching tuple count if "select count(*)"
+  if (attr == 4) {
+    fprintf(stdout, "%d\n", count);
+  }
+  return 0;
+}
+
+// compute the range of values allowed by the value conditions: from lo
+// up to hi, or without end if hasHi is false.
+// return false if no value can meet the conditions.
+static bool valueRange(const vector<SelCond>& cond, string& lo, string& hi, bool& hasHi)
+{
+  lo.clear();
+  hasHi = false;
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr != 2) continue;
+    string v = cond[i].value;
+    SelCond::Comparator comp = cond[i].comp;
+    if ((comp == SelCond::EQ || comp == SelCond::GT || comp == SelCond::GE) && v > lo) {
+      lo = v;
+    }
+    if ((comp == SelCond::EQ || comp == SelCond::LT || comp == SelCond::LE) && (!hasHi || v < hi)) {
+      hi = v;
+      hasHi = true;
+    }
+  }
+  return !hasHi || lo <= hi;
+}
+
+// run a SELECT with conditions on the value through the value index of the
+// table. only the values in range are scanned, and the table file is read
+// only for the tuples whose key is needed.
+static RC selectValueIndex(int attr, const string& table, RecordFile& rf,
+                           StringIndex& vi, const vector<SelCond>& cond)
+{
+  RC   rc;
+  int  count = 0;
+  bool needKey = (attr == 1 || attr == 3);
+  string lo, hi;
+  bool hasHi;
+
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 1) needKey = true;
+  }
+
+  if (valueRange(cond, lo, hi, hasHi)) {
+    StringCursor cursor;
+    RecordId     rid;
+    string       value;
+    string       tupleValue;
+
+    rc = vi.locate(lo, cursor);
+    while (rc == 0 && (rc = vi.readForward(cursor, value, rid)) == 0) {
+      if (hasHi && value > hi) {
+        rc = RC_END_OF_TREE;
+        break;
+      }
+      int key = 0;
+      if (needKey && (rc = rf.read(rid, key, tupleValue)) < 0) break;
+      if (!checkConds(cond, key, value.c_str())) continue;
+      count++;
+
+      switch (attr) {
+      case 1:  // SELECT key
+        fprintf(stdout, "%d\n", key);
+        break;
+      case 2:  // SELECT value
+        fprintf(stdout, "%s\n", value.c_str());
+        break;
+      case 3:  // SELECT *
+        fprintf(stdout, "%d '%s'\n", key, value.c_str());
+        break;
+      }
+    }
+    if (rc != RC_END_OF_TREE) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      return rc;
+    }
+  }
+
+  // print matching tuple count if "select count(*)"
+  if (attr == 4) {
+    fprintf(stdout, "%d\n", count);
+  }
+  return 0;
+}
+
+// count the tuples that meet conditions on the key alone from the index.
+// an index with entry counts does so without reading its leaves.
+static RC countIndex(BTreeIndex& bti, const vector<SelCond>& cond, int& count)
+{
+  RC  rc;
+  int lo, hi;
+
+  count = 0;
+  if (!keyRange(cond, lo, hi)) return 0;
+  if ((rc = bti.countRange(lo, hi, count)) < 0) return rc;
+
+  // take out the keys the NE conditions rule out, each key once
+  set<int> excluded;
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr != 1 || cond[i].comp != SelCond::NE) continue;
+    int v = atoi(cond[i].value);
+    if (v < lo || v > hi || !excluded.insert(v).second) continue;
+    int n;
+    if ((rc = bti.countRange(v, v, n)) < 0) return rc;
+    count -= n;
+  }
+  return 0;
+}
+
+// run a SELECT through the index of the table. the index returns the
+// tuples in key order, so only the keys in [lo, hi] are scanned, and the
+// table file is read only for the tuples whose value is needed. a covering
+// index answers from its value prefixes wherever they are enough.
+static RC selectIndex(int attr, const string& table, RecordFile& rf,
+                      BTreeIndex& bti, const vector<SelCond>& cond)
+{
+  RC   rc;
+  int  lo, hi;
+  int  count = 0;
+  bool printValue = (attr == 2 || attr == 3);
+  bool needValue = printValue;
+  bool covering = bti.getValuePrefix() > 0;
+
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 2) needValue = true;
+  }
+
+  // a COUNT(*) on the key alone needs no entries at all
+  if (attr == 4 && !needValue) {
+    if ((rc = countIndex(bti, cond, count)) < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      return rc;
+    }
+    fprintf(stdout, "%d\n", count);
+    return 0;
+  }
+
+  if (keyRange(cond, lo, hi)) {
+    IndexScan  scan;
+    int        keys[MAX_KEY_RECORDS];
+    RecordId   rids[MAX_KEY_RECORDS];
+    IndexValue values[MAX_KEY_RECORDS];
+    int        n;
+    int        key;
+    string     value;
+
+    rc = bti.openScan(lo, hi, scan);
+    while (rc == 0 && (rc = bti.readScan(scan, keys, rids, covering ? values : NULL,
+                                         MAX_KEY_RECORDS, n)) == 0) {
+      for (int i = 0; i < n; i++) {
+        const char* v = "";
+        if (needValue) {
+          int met = covering ? checkCondsPrefix(cond, keys[i], values[i]) : -1;
+          if (met == 0) continue;
+          if (met < 0 || (printValue && values[i].state != VALUE_COMPLETE)) {
+            if ((rc = rf.read(rids[i], key, value)) < 0) break;
+            if (met < 0 && !checkConds(cond, keys[i], value.c_str())) continue;
+            v = value.c_str();
+          } else {
+            v = values[i].prefix;
+          }
+        } else if (!checkConds(cond, keys[i], v)) {
+          continue;
+        }
+        count++;
+
+        switch (attr) {
+        case 1:  // SELECT key
+          fprintf(stdout, "%d\n", keys[i]);
+          break;
+        case 2:  // SELECT value
+          fprintf(stdout, "%s\n", v);
+          break;
+        case 3:  // SELECT *
+          fprintf(stdout, "%d '%s'\n", keys[i], v);
+          break;
+        }
+      }
+    }
+    if (rc != RC_END_OF_TREE) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      return rc;
+    }
+  }
+
+  // print matching tuple count if "select count(*)"
+  if (attr == 4) {
+    fprintf(stdout, "%d\n", count);
+  }
+  return 0;
+}
 
 RC SqlEngine::run(FILE* commandline)
 {
@@ -42,10 +496,27 @@ RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
   RecordId   rid;  // record cursor for table scanning
 
   RC     rc;
-  int    key;     
-  string value;
   int    count;
-  int    diff;
+
+  BTreeIndex bti;             // the index of the table, if it has one
+  HashIndex  hi;              // the hash index of the table, if it has one
+  StringIndex vi;             // the value index of the table, if it has one
+  int        eqKey;
+  string     eqValue;
+  bool       keyCond = false;
+  bool       valueCond = false;
+  bool       valueBound = false;
+  bool       valueEq = false;
+
+  RecordBatch* batch = NULL;                 // records of the table scan
+  int          sel[RecordFile::BATCH_SIZE];  // selected entries of the batch
+  int          nsel;
+
+  // a frozen snapshot of the table is answered without touching table.tbl
+  FrozenTable ft;
+  if (ft.open(table + ".frz") == 0) {
+    return selectFrozen(attr, ft, cond);
+  }
 
   // open the table file
   if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
@@ -53,218 +524,94 @@ RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
     return rc;
   }
 
+  // a key = N lookup goes to the hash index, which reads one bucket
+  if (keyEquals(cond, eqKey) && hi.open(table + ".hidx", 'r') == 0) {
+    rc = selectHash(attr, table, rf, hi, eqKey, cond);
+    hi.close();
+    goto exit_select;
+  }
 
+  // so does a value = 'v' lookup, to the hash index on the value
+  if (valueEquals(cond, eqValue) && hi.open(table + ".vhidx", 'r') == 0) {
+    rc = selectHash(attr, table, rf, hi, HashIndex::hashValue(eqValue), cond);
+    hi.close();
+    goto exit_select;
+  }
 
-    // If the tree index
-  BTreeIndex bti;
-  if (bti.open(table + ".idx", 'r') == 0) {
-      count = 0;
-
-      // Get the minimum value to search for initially in the tree
-      int minVal = INT_MIN;
-      for (int i = 0; i < cond.size(); i++) {
-          if (cond[i].attr == 1 && (cond[i].comp == SelCond::EQ ||
-                                    cond[i].comp == SelCond::GT ||
-                                    cond[i].comp == SelCond::GE)) {
-              if (minVal < atoi(cond[i].value))
-                  minVal = atoi(cond[i].value);
-          }
-
-      }
-
-      // Locate the minVal
-      IndexCursor cursor;
-      bti.locate(minVal, cursor);
-      bool readmore = true;
-
-      while (readmore) {
-
-          readmore = true;
-          bool printOrCount = true;
-          bool valueSetForThisRow = false;
-
-          // read the tuple
-          rc = bti.readForward(cursor, key, rid);
-          if ((rc < 0)) {
-              if (rc == RC_END_OF_TREE) {
-                  if (attr == 4) {
-                      goto print_count;
-                  }
-                  goto exit_select;
-              }
-
-              fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-              goto exit_select;
-          }
-
-          // check the conditions on the tuple
-          for (unsigned i = 0; i < cond.size(); i++) {
-              // compute the difference between the tuple value and the condition value
-              switch (cond[i].attr) {
-                  case 1:
-                      diff = key - atoi(cond[i].value);
-                      break;
-                  case 2:
-                      if (!valueSetForThisRow) {
-                          if ((rc = rf.read(rid, key, value)) < 0) {
-                              fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-                              goto exit_select;
-                          }
-                          valueSetForThisRow = true;
-                      }
-
-                      diff = strcmp(value.c_str(), cond[i].value);
-                      break;
-              }
-
-              // skip the tuple if any condition is not met
-              switch (cond[i].comp) {
-                  case SelCond::EQ:
-                      if (diff != 0) {
-                          if (cond[i].attr == 1) {
-                              readmore = false;
-                          }
-                          printOrCount = false;
-                      }
-                      break;
-                  case SelCond::NE:
-                      if (diff == 0)
-                          printOrCount = false;
-                      break;
-                  case SelCond::GT:
-                      if (diff <= 0)
-                          printOrCount = false;
-                      break;
-                  case SelCond::LT:
-                      if (diff >= 0) {
-                          if (cond[i].attr == 1) {
-                              readmore = false;
-                          }
-                          printOrCount = false;
-                      }
-                      break;
-                  case SelCond::GE:
-                      if (diff < 0)
-                          printOrCount = false;
-                      break;
-                  case SelCond::LE:
-                      if (diff >= 0) {
-                          if (cond[i].attr == 1) {
-                              readmore = false;
-                          }
-                          printOrCount = false;
-                      }
-                      break;
-              }
-          }
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 1 && cond[i].comp != SelCond::NE) keyCond = true;
+    if (cond[i].attr == 2) valueCond = true;
+    if (cond[i].attr == 2 && cond[i].comp != SelCond::NE) valueBound = true;
+    if (cond[i].attr == 2 && cond[i].comp == SelCond::EQ) valueEq = true;
+  }
 
-          if (printOrCount) {
-              // the condition is met for the tuple.
-              // increase matching tuple counter
-              count++;
-
-              // print the tuple if it needs to be printed
-              switch (attr) {
-                  case 1:  // SELECT key
-                      fprintf(stdout, "%d\n", key);
-                      break;
-                  case 2:  // SELECT value
-                      if (!valueSetForThisRow) {
-                          if ((rc = rf.read(rid, key, value)) < 0) {
-                              fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-                              goto exit_select;
-                          }
-                          valueSetForThisRow = true;
-                      }
-
-                      fprintf(stdout, "%s\n", value.c_str());
-                      break;
-                  case 3:  // SELECT *
-                      if (!valueSetForThisRow) {
-                          if ((rc = rf.read(rid, key, value)) < 0) {
-                              fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-                              goto exit_select;
-                          }
-                          valueSetForThisRow = true;
-                      }
-
-                      fprintf(stdout, "%d '%s'\n", key, value.c_str());
-                      break;
-              }
-          }
-      }
+  // a value = 'v' lookup goes to the value index, and so does a value
+  // range unless the key conditions narrow the scan down
+  if ((valueEq || (valueBound && !keyCond)) && vi.open(table + ".vidx", 'r') == 0) {
+    rc = selectValueIndex(attr, table, rf, vi, cond);
+    vi.close();
+    goto exit_select;
+  }
 
+  // use the index when the key conditions narrow the scan down, or when
+  // nothing but the keys is needed and the table file need not be read.
+  // a covering index can also check the value conditions on its own.
+  if ((keyCond || attr == 1 || attr == 4) && bti.open(table + ".idx", 'r') == 0) {
+    if (keyCond || !valueCond || bti.getValuePrefix() > 0) {
+      rc = selectIndex(attr, table, rf, bti, cond);
+      bti.close();
       goto exit_select;
+    }
+    bti.close();
   }
 
-  // scan the table file from the beginning
+  // scan the table file from the beginning, one batch of records at a time
   rid.pid = rid.sid = 0;
   count = 0;
+  batch = new RecordBatch;
   while (rid < rf.endRid()) {
-    // read the tuple
-    if ((rc = rf.read(rid, key, value)) < 0) {
+    // read the next batch of tuples
+    if ((rc = rf.readBatch(rid, *batch)) < 0) {
       fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
       goto exit_select;
     }
 
-    // check the conditions on the tuple
-    for (unsigned i = 0; i < cond.size(); i++) {
-      // compute the difference between the tuple value and the condition value
+    // start with the whole batch selected and drop the tuples
+    // that do not meet each condition in turn
+    nsel = batch->count;
+    for (int i = 0; i < nsel; i++) sel[i] = i;
+    for (unsigned i = 0; i < cond.size() && nsel > 0; i++) {
       switch (cond[i].attr) {
       case 1:
-	diff = key - atoi(cond[i].value);
+	nsel = filterKeys(batch->keys, sel, nsel, cond[i].comp, atoi(cond[i].value));
 	break;
       case 2:
-	diff = strcmp(value.c_str(), cond[i].value);
+	nsel = filterValues(batch->values, sel, nsel, cond[i].comp, cond[i].value);
 	break;
       }
+    }
 
-      // skip the tuple if any condition is not met
-      switch (cond[i].comp) {
-      case SelCond::EQ:
-	if (diff != 0) goto next_tuple;
-	break;
-      case SelCond::NE:
-	if (diff == 0) goto next_tuple;
-	break;
-      case SelCond::GT:
-	if (diff <= 0) goto next_tuple;
-	break;
-      case SelCond::LT:
-	if (diff >= 0) goto next_tuple;
+    // the conditions are met for the selected tuples.
+    // increase matching tuple counter
+    count += nsel;
+
+    // print the tuples
+    for (int i = 0; i < nsel; i++) {
+      int j = sel[i];
+      switch (attr) {
+      case 1:  // SELECT key
+	fprintf(stdout, "%d\n", batch->keys[j]);
 	break;
-      case SelCond::GE:
-	if (diff < 0) goto next_tuple;
+      case 2:  // SELECT value
+	fprintf(stdout, "%s\n", batch->values[j]);
 	break;
-      case SelCond::LE:
-	if (diff > 0) goto next_tuple;
+      case 3:  // SELECT *
+	fprintf(stdout, "%d '%s'\n", batch->keys[j], batch->values[j]);
 	break;
       }
     }
-
-    // the condition is met for the tuple. 
-    // increase matching tuple counter
-    count++;
-
-    // print the tuple 
-    switch (attr) {
-    case 1:  // SELECT key
-      fprintf(stdout, "%d\n", key);
-      break;
-    case 2:  // SELECT value
-      fprintf(stdout, "%s\n", value.c_str());
-      break;
-    case 3:  // SELECT *
-      fprintf(stdout, "%d '%s'\n", key, value.c_str());
-      break;
-    }
-
-    // move to the next tuple
-    next_tuple:
-    ++rid;
   }
 
-    print_count:
     // print matching tuple count if "select count(*)"
     if (attr == 4) {
         fprintf(stdout, "%d\n", count);
@@ -273,28 +620,367 @@ RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
 
     // close the table file and return
     exit_select:
+    delete batch;
     rf.close();
     return rc;
 }
 
-RC SqlEngine::load(const string& table, const string& loadfile, bool index)
+// find the tuples of a table that meet the conditions through its index
+static RC findIndexMatches(RecordFile& rf, BTreeIndex& bti, const vector<SelCond>& cond,
+                           vector<pair<int, RecordId> >& matches)
+{
+  RC   rc;
+  int  lo, hi;
+  bool needValue = false;
+
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 2) needValue = true;
+  }
+  if (!keyRange(cond, lo, hi)) return 0;
+
+  IndexScan  scan;
+  int        keys[MAX_KEY_RECORDS];
+  RecordId   rids[MAX_KEY_RECORDS];
+  IndexValue values[MAX_KEY_RECORDS];
+  int        n;
+  int        key;
+  string     value;
+  bool       covering = bti.getValuePrefix() > 0;
+
+  rc = bti.openScan(lo, hi, scan);
+  while (rc == 0 && (rc = bti.readScan(scan, keys, rids, covering ? values : NULL,
+                                       MAX_KEY_RECORDS, n)) == 0) {
+    for (int i = 0; i < n; i++) {
+      int met = covering ? checkCondsPrefix(cond, keys[i], values[i]) : -1;
+      if (met < 0) {
+        if (needValue && (rc = rf.read(rids[i], key, value)) < 0) return rc;
+        met = checkConds(cond, keys[i], value.c_str());
+      }
+      if (met) {
+        matches.push_back(make_pair(keys[i], rids[i]));
+      }
+    }
+  }
+  return rc == RC_END_OF_TREE ? 0 : rc;
+}
+
+// find the tuples of a table that meet the conditions through a hash
+// index of it, hashKey being the key of the index an EQ condition asks for
+static RC findHashMatches(RecordFile& rf, HashIndex& hi, long long hashKey,
+                          const vector<SelCond>& cond, vector<pair<int, RecordId> >& matches)
+{
+  RC   rc;
+  int  eqKey = 0;
+  bool needValue = !keyEquals(cond, eqKey);
+  vector<RecordId> rids;
+
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 2) needValue = true;
+  }
+  if ((rc = hi.find(hashKey, rids)) < 0) return rc;
+  sort(rids.begin(), rids.end());
+
+  for (unsigned i = 0; i < rids.size(); i++) {
+    int    key = eqKey;
+    string value;
+    if (needValue && (rc = rf.read(rids[i], key, value)) < 0) return rc;
+    if (checkConds(cond, key, value.c_str())) {
+      matches.push_back(make_pair(key, rids[i]));
+    }
+  }
+  return 0;
+}
+
+// find the tuples of a table that meet the conditions through its value index
+static RC findValueMatches(RecordFile& rf, StringIndex& vi, const vector<SelCond>& cond,
+                           vector<pair<int, RecordId> >& matches)
+{
+  RC           rc;
+  string       lo, hi;
+  bool         hasHi;
+  StringCursor cursor;
+  RecordId     rid;
+  string       value;
+  string       tupleValue;
+
+  if (!valueRange(cond, lo, hi, hasHi)) return 0;
+
+  rc = vi.locate(lo, cursor);
+  while (rc == 0 && (rc = vi.readForward(cursor, value, rid)) == 0) {
+    if (hasHi && value > hi) return 0;
+    int key;
+    if ((rc = rf.read(rid, key, tupleValue)) < 0) return rc;
+    if (checkConds(cond, key, value.c_str())) {
+      matches.push_back(make_pair(key, rid));
+    }
+  }
+  return rc == RC_END_OF_TREE ? 0 : rc;
+}
+
+// find the tuples of a table that meet the conditions by scanning the table
+static RC findScanMatches(RecordFile& rf, const vector<SelCond>& cond,
+                          vector<pair<int, RecordId> >& matches)
+{
+  RC           rc = 0;
+  RecordId     rid;
+  RecordBatch* batch = new RecordBatch;
+  int          sel[RecordFile::BATCH_SIZE];
+
+  rid.pid = rid.sid = 0;
+  while (rid < rf.endRid()) {
+    if ((rc = rf.readBatch(rid, *batch)) < 0) break;
+
+    int nsel = batch->count;
+    for (int i = 0; i < nsel; i++) sel[i] = i;
+    for (unsigned i = 0; i < cond.size() && nsel > 0; i++) {
+      if (cond[i].attr == 1) {
+        nsel = filterKeys(batch->keys, sel, nsel, cond[i].comp, atoi(cond[i].value));
+      } else {
+        nsel = filterValues(batch->values, sel, nsel, cond[i].comp, cond[i].value);
+      }
+    }
+    for (int i = 0; i < nsel; i++) {
+      matches.push_back(make_pair(batch->keys[sel[i]], batch->rids[sel[i]]));
+    }
+  }
+  delete batch;
+  return rc < 0 ? rc : 0;
+}
+
+RC SqlEngine::remove(const string& table, const vector<SelCond>& cond)
+{
+  RecordFile rf;
+  BTreeIndex bti;
+  HashIndex  hi;
+  HashIndex  vhi;
+  StringIndex vi;
+  bool       indexed;
+  bool       hashed;
+  bool       valueHashed;
+  bool       valued;
+  int        eqKey;
+  string     eqValue;
+  bool       keyCond = false;
+  bool       valueBound = false;
+  bool       valueEq = false;
+  RC         rc;
+
+  vector<pair<int, RecordId> > matches;  // the (key, rid) of the tuples to remove
+
+  // opening a table file for writing creates it, so check that it is there
+  if (access((table + ".tbl").c_str(), F_OK) != 0 || (rc = rf.open(table + ".tbl", 'w')) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+    return RC_FILE_OPEN_FAILED;
+  }
+  indexed = access((table + ".idx").c_str(), F_OK) == 0 && bti.open(table + ".idx", 'w') == 0;
+  hashed = access((table + ".hidx").c_str(), F_OK) == 0 && hi.open(table + ".hidx", 'w') == 0;
+  valueHashed = access((table + ".vhidx").c_str(), F_OK) == 0 && vhi.open(table + ".vhidx", 'w') == 0;
+  valued = access((table + ".vidx").c_str(), F_OK) == 0 && vi.open(table + ".vidx", 'w') == 0;
+
+  // find all matches before removing any, so that removing tuples
+  // does not get in the way of the scan that finds them
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 1 && cond[i].comp != SelCond::NE) keyCond = true;
+    if (cond[i].attr == 2 && cond[i].comp != SelCond::NE) valueBound = true;
+    if (cond[i].attr == 2 && cond[i].comp == SelCond::EQ) valueEq = true;
+  }
+  if (hashed && keyEquals(cond, eqKey)) {
+    rc = findHashMatches(rf, hi, eqKey, cond, matches);
+  } else if (valueHashed && valueEquals(cond, eqValue)) {
+    rc = findHashMatches(rf, vhi, HashIndex::hashValue(eqValue), cond, matches);
+  } else if (valued && (valueEq || (valueBound && !keyCond))) {
+    rc = findValueMatches(rf, vi, cond, matches);
+  } else if (indexed && keyCond) {
+    rc = findIndexMatches(rf, bti, cond, matches);
+  } else {
+    rc = findScanMatches(rf, cond, matches);
+  }
+
+  for (unsigned i = 0; rc == 0 && i < matches.size(); i++) {
+    // the value indexes need the value of the tuple, which goes with it
+    int    key;
+    string value;
+    if ((valued || valueHashed) && (rc = rf.read(matches[i].second, key, value)) < 0) break;
+    rc = rf.remove(matches[i].second);
+    if (rc == 0 && indexed) {
+      rc = bti.remove(matches[i].first, matches[i].second);
+    }
+    if (rc == 0 && hashed) {
+      rc = hi.remove(matches[i].first, matches[i].second);
+    }
+    if (rc == 0 && valueHashed) {
+      rc = vhi.remove(HashIndex::hashValue(value), matches[i].second);
+    }
+    if (rc == 0 && valued) {
+      rc = vi.remove(value, matches[i].second);
+    }
+  }
+  if (rc < 0) {
+    fprintf(stderr, "Error: while deleting a tuple from table %s\n", table.c_str());
+  }
+
+  // a frozen snapshot of the table is stale once the table changes
+  if (!matches.empty()) {
+    unlink((table + ".frz").c_str());
+  }
+
+  if (indexed) bti.close();
+  if (hashed) hi.close();
+  if (valueHashed) vhi.close();
+  if (valued) vi.close();
+  rf.close();
+  return rc;
+}
+
+// how full LOAD ... WITH INDEX makes the index nodes
+static const double INDEX_FILL_FACTOR = 1.0;
+
+// the memory LOAD ... WITH INDEX may use to sort the index entries
+static const int INDEX_SORT_MEMORY = 1 << 20;
+
+// the number of sorted entries LOAD puts into a non-empty index at a time
+static const int INDEX_INSERT_BATCH = 4096;
+
+// the length of the value prefixes LOAD ... WITH COVERING INDEX keeps in
+// the leaves. 90% of the values of the movie tables fit in it completely.
+static const int COVERING_VALUE_PREFIX = 24;
+
+// build the index from its sorted (key, rid) entries, bottom-up if it is
+// empty. a covering index gets the value prefixes sorted along with them.
+static RC buildIndex(BTreeIndex& bti, ExternalSort& entries)
+{
+  RC       rc;
+  int      key;
+  RecordId rid;
+  char     value[MAX_VALUE_PREFIX + 2];
+  char*    v = bti.getValuePrefix() > 0 ? value : NULL;
+
+  if ((rc = entries.finish()) < 0) return rc;
+
+  if (bti.bulkLoadBegin(INDEX_FILL_FACTOR) == 0) {
+    while ((rc = entries.next(key, rid, value)) == 0) {
+      if ((rc = bti.bulkLoadAppend(key, rid, v)) < 0) return rc;
+    }
+    if (rc != RC_END_OF_TREE) return rc;
+    return bti.bulkLoadEnd();
+  }
+
+  // the index already holds entries of an earlier load. the entries come
+  // in key order, so the ones that go to the same leaf go in together.
+  vector<int>      keys;
+  vector<RecordId> rids;
+  vector<string>   values;
+  vector<const char*> vs;
+  do {
+    keys.clear();
+    rids.clear();
+    values.clear();
+    while ((int) keys.size() < INDEX_INSERT_BATCH && (rc = entries.next(key, rid, value)) == 0) {
+      keys.push_back(key);
+      rids.push_back(rid);
+      values.push_back(v != NULL ? v : "");
+    }
+    if (rc < 0 && rc != RC_END_OF_TREE) return rc;
+
+    vs.clear();
+    for (unsigned i = 0; i < values.size(); i++) vs.push_back(values[i].c_str());
+    if (!keys.empty() &&
+        (rc = bti.insertBatch(&keys[0], &rids[0], v != NULL ? &vs[0] : NULL, keys.size())) < 0) {
+      return rc;
+    }
+  } while ((int) keys.size() == INDEX_INSERT_BATCH);
+  return 0;
+}
+
+// add the value of a tuple to the sort of a value index. the values are
+// sorted as the payloads of the pairs, with the key left out of the order.
+static RC addValue(ExternalSort& values, const char* value, const RecordId& rid)
+{
+  char payload[RecordFile::MAX_VALUE_LENGTH] = { 0 };
+  strncpy(payload, value, RecordFile::MAX_VALUE_LENGTH - 1);
+  return values.add(0, rid, payload);
+}
+
+// build the value index from the sorted (value, rid) pairs of the tuples,
+// bottom-up if it is empty
+static RC buildValueIndex(StringIndex& vi, ExternalSort& values)
+{
+  RC       rc;
+  int      key;
+  RecordId rid;
+  char     value[RecordFile::MAX_VALUE_LENGTH];
+  bool     bulk;
+
+  if ((rc = values.finish()) < 0) return rc;
+
+  bulk = (vi.bulkLoadBegin() == 0);
+  while ((rc = values.next(key, rid, value)) == 0) {
+    if (bulk) rc = vi.bulkLoadAppend(value, rid);
+    else rc = vi.insert(value, rid);
+    if (rc < 0) return rc;
+  }
+  if (rc != RC_END_OF_TREE) return rc;
+  return bulk ? vi.bulkLoadEnd() : 0;
+}
+
+RC SqlEngine::load(const string& table, const string& loadfile, IndexType index)
 {
     // Opens the RecordFile in write mode, and opens the loadfile.
     RecordFile rf(table + ".tbl", 'w');
     ifstream tableFile(loadfile.c_str());
 
+    // a frozen snapshot of the table is stale once the table changes
+    unlink((table + ".frz").c_str());
 
+    // a covering index sorts a prefix of every value along with its entry:
+    // one character more than the leaves keep, so that they can tell
+    // whether the value is complete, and the terminating NUL.
+    // a table that already has an index keeps it up to date.
     BTreeIndex bti;
-    if (index) {
+    int prefix = 0;
+    bool tree = (index == KEY_INDEX || index == COVERING_INDEX || index == COUNTED_INDEX ||
+                 access((table + ".idx").c_str(), F_OK) == 0);
+    if (tree) {
         bti.open(table + ".idx", 'w');
+        if (index == COVERING_INDEX) {
+            bti.setValuePrefix(COVERING_VALUE_PREFIX);
+        } else if (index == COUNTED_INDEX) {
+            bti.setEntryCounts(true);
+        }
+        prefix = bti.getValuePrefix();
+    }
+    ExternalSort entries(table + ".idx", INDEX_SORT_MEMORY, prefix > 0 ? prefix + 2 : 0);
+
+    // a hash index takes the tuples as they are appended, and so does a
+    // hash index on the value. a table that already has one keeps it up to date.
+    HashIndex hi;
+    bool hashed = (index == HASH_INDEX || access((table + ".hidx").c_str(), F_OK) == 0);
+    if (hashed) {
+        hi.open(table + ".hidx", 'w');
     }
 
+    HashIndex vhi;
+    bool valueHashed = (index == VALUE_HASH_INDEX || access((table + ".vhidx").c_str(), F_OK) == 0);
+    if (valueHashed) {
+        vhi.open(table + ".vhidx", 'w');
+    }
+
+    // the (value, rid) pairs for the value index are sorted like the
+    // index entries. a table that already has a value index keeps it up to date.
+    StringIndex vi;
+    ExternalSort values(table + ".vidx", INDEX_SORT_MEMORY, RecordFile::MAX_VALUE_LENGTH, true);
+    bool valued = (index == VALUE_INDEX || access((table + ".vidx").c_str(), F_OK) == 0);
+    if (valued) {
+        vi.open(table + ".vidx", 'w');
+    }
+
+    RC rc = 0;
     if (tableFile.is_open())
     {
         string tuple;
 
         // Reads every line of the loadfile into the tuple string.
-        while ( getline (tableFile,tuple) )
+        while ( rc == 0 && getline (tableFile,tuple) )
         {
             int key;
             string value;
@@ -303,9 +989,23 @@ RC SqlEngine::load(const string& table, const string& loadfile, bool index)
             int resVal = parseLoadLine(tuple, key, value);
             if (resVal == 0) {
                 RecordId rid;
-                rf.append(key, value, rid);
-                if (index) {
-                    bti.insert(key, rid);
+                rc = rf.append(key, value, rid);
+                if (rc == 0 && hashed) {
+                    rc = hi.insert(key, rid);
+                }
+                if (rc == 0 && tree) {
+                    char payload[MAX_VALUE_PREFIX + 2] = { 0 };
+                    strncpy(payload, value.c_str(), prefix + 1);
+                    rc = entries.add(key, rid, payload);
+                }
+                if (rc == 0 && valueHashed) {
+                    rc = vhi.insert(HashIndex::hashValue(value), rid);
+                }
+                if (rc == 0 && valued) {
+                    rc = addValue(values, value.c_str(), rid);
+                }
+                if (rc < 0) {
+                    fprintf(stderr, "Error: while loading a tuple into table %s\n", table.c_str());
                 }
 
             } else {
@@ -316,17 +1016,90 @@ RC SqlEngine::load(const string& table, const string& loadfile, bool index)
         }
         tableFile.close();
 
-        if (index) {
-            bti.close();
+        // The index is built in one pass once all tuples are in place
+        if (rc == 0 && tree) {
+            rc = buildIndex(bti, entries);
+            if (rc < 0) {
+                cout << "Error building index: " << rc << endl;
+            }
+        }
+        if (rc == 0 && valued) {
+            rc = buildValueIndex(vi, values);
+            if (rc < 0) {
+                cout << "Error building index: " << rc << endl;
+            }
         }
     }
     else {
         cout << "Error loading from file: " << loadfile << endl;
+        rc = RC_FILE_OPEN_FAILED;
     }
 
+    if (tree) {
+        bti.close();
+    }
+    if (hashed) {
+        hi.close();
+    }
+    if (valueHashed) {
+        vhi.close();
+    }
+    if (valued) {
+        vi.close();
+    }
     rf.close();
 
-  return 0;
+  return rc;
+}
+
+RC SqlEngine::freeze(const string& table)
+{
+  RC rc = FrozenTable::freeze(table);
+  if (rc < 0) {
+    fprintf(stderr, "Error: cannot freeze table %s\n", table.c_str());
+  }
+  return rc;
+}
+
+RC SqlEngine::createValueIndex(const string& table)
+{
+  RecordFile   rf;
+  StringIndex  vi;
+  RecordId     rid;
+  RecordBatch* batch;
+  RC           rc;
+
+  ExternalSort values(table + ".vidx", INDEX_SORT_MEMORY, RecordFile::MAX_VALUE_LENGTH, true);
+
+  if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+    return rc;
+  }
+
+  rid.pid = rid.sid = 0;
+  batch = new RecordBatch;
+  while (rid < rf.endRid()) {
+    if ((rc = rf.readBatch(rid, *batch)) < 0) break;
+    for (int i = 0; i < batch->count && rc >= 0; i++) {
+      rc = addValue(values, batch->values[i], batch->rids[i]);
+    }
+    if (rc < 0) break;
+  }
+  delete batch;
+  rf.close();
+
+  // the index is built anew from the tuples
+  if (rc >= 0) {
+    unlink((table + ".vidx").c_str());
+    if ((rc = vi.open(table + ".vidx", 'w')) == 0) {
+      rc = buildValueIndex(vi, values);
+      vi.close();
+    }
+  }
+  if (rc < 0) {
+    fprintf(stderr, "Error: cannot create the value index of table %s\n", table.c_str());
+  }
+  return rc;
 }
 
 RC SqlEngine::parseLoadLine(const string& line, int& key, string& value)
@@ -28,6 +28,24 @@ struct SelCond {
  */
 class SqlEngine {
  public:
+
+  /**
+   * the index that LOAD builds for a table
+   */
+  enum IndexType {
+    NO_INDEX,        // no index
+    KEY_INDEX,       // "WITH INDEX": a B+tree on the key
+    COVERING_INDEX,  // "WITH COVERING INDEX": a B+tree on the key whose
+                     // leaves also keep a prefix of every value
+    COUNTED_INDEX,   // "WITH COUNTED INDEX": a B+tree on the key whose
+                     // nonleaf nodes keep entry counts for COUNT(*)
+    HASH_INDEX,      // "WITH HASH INDEX": an extendible hash index on
+                     // the key (table.hidx) for key = N lookups
+    VALUE_INDEX,     // "WITH VALUE INDEX": a B+tree on the value
+                     // (table.vidx) for value lookups and ranges
+    VALUE_HASH_INDEX // "WITH VALUE HASH INDEX": an extendible hash index on
+                     // the hash of the value (table.vhidx) for value = 'v'
+  };
     
   /**
    * takes the user commands from commandline and executes them.
@@ -50,14 +68,41 @@ class SqlEngine {
    */
   static RC select(int attr, const std::string& table, const std::vector<SelCond>& conds);
 
+  /**
+   * executes a DELETE statement.
+   * all conditions in conds must be ANDed together, and the tuples
+   * that meet them are removed from the table and from its index.
+   * @param table[IN] the table name in the FROM clause
+   * @param conds[IN] list of conditions in the WHERE clause
+   * @return error code. 0 if no error
+   */
+  static RC remove(const std::string& table, const std::vector<SelCond>& conds);
+
   /**
    * load a table from a load file.
    * @param table[IN] the table name in the LOAD command
    * @param loadfile[IN] the file name of the load file
-   * @param index[IN] true if "WITH INDEX" option was specified
+   * @param index[IN] the index given by the "WITH ... INDEX" option
+   * @return error code. 0 if no error
+   */
+  static RC load(const std::string& table, const std::string& loadfile, IndexType index);
+
+  /**
+   * build an immutable, memory-mapped snapshot of a table (table.frz).
+   * SELECTs on the table read from the snapshot until the table
+   * is loaded again.
+   * @param table[IN] the table name in the FREEZE command
+   * @return error code. 0 if no error
+   */
+  static RC freeze(const std::string& table);
+
+  /**
+   * build the value index of a table (table.vidx) from the tuples it holds.
+   * once built, LOAD and DELETE keep the index up to date.
+   * @param table[IN] the table name in the CREATE VALUE INDEX command
    * @return error code. 0 if no error
    */
-  static RC load(const std::string& table, const std::string& loadfile, bool index);
+  static RC createValueIndex(const std::string& table);
 
   /**
    * parse a line from the load file into the (key, value) pair.
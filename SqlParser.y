@@ -37,7 +37,7 @@ static void runSelect(int attr, const char* table, const std::vector<SelCond>& c
   std::vector<SelCond>* conds;
 }
 
-%token SELECT FROM WHERE LOAD WITH INDEX QUIT COUNT AND OR 
+%token SELECT FROM WHERE LOAD WITH INDEX QUIT FREEZE DELETE CREATE ON VALUE HASH COVERING COUNTED COUNT AND OR 
 %token COMMA STAR LF
 %token <string> INTEGER STRING ID
 %token EQUAL NEQUAL LESS LESSEQUAL GREATER GREATEREQUAL 
@@ -56,6 +56,9 @@ commands:
 command:
         load_command { fprintf(stdout, "Bruinbase> "); }
 	| select_command { fprintf(stdout, "Bruinbase> "); }
+	| freeze_command { fprintf(stdout, "Bruinbase> "); }
+	| delete_command { fprintf(stdout, "Bruinbase> "); }
+	| create_command { fprintf(stdout, "Bruinbase> "); }
 	| quit_command
 	| error LF { fprintf(stdout, "Bruinbase> "); }
 	| LF { fprintf(stdout, "Bruinbase> "); }
@@ -67,17 +70,72 @@ quit_command:
 
 load_command:
 	LOAD table FROM STRING LF { 
-	  SqlEngine::load(std::string($2), std::string($4), false); 
+	  SqlEngine::load(std::string($2), std::string($4), SqlEngine::NO_INDEX); 
 	  free($2);
 	  free($4);
 	}
 	| LOAD table FROM STRING WITH INDEX LF { 
-	  SqlEngine::load(std::string($2), std::string($4), true); 
+	  SqlEngine::load(std::string($2), std::string($4), SqlEngine::KEY_INDEX); 
+	  free($2);
+	  free($4);
+	}
+	| LOAD table FROM STRING WITH COVERING INDEX LF { 
+	  SqlEngine::load(std::string($2), std::string($4), SqlEngine::COVERING_INDEX);
+	  free($2);
+	  free($4);
+	}
+	| LOAD table FROM STRING WITH COUNTED INDEX LF { 
+	  SqlEngine::load(std::string($2), std::string($4), SqlEngine::COUNTED_INDEX);
+	  free($2);
+	  free($4);
+	}
+	| LOAD table FROM STRING WITH VALUE INDEX LF { 
+	  SqlEngine::load(std::string($2), std::string($4), SqlEngine::VALUE_INDEX);
+	  free($2);
+	  free($4);
+	}
+	| LOAD table FROM STRING WITH HASH INDEX LF { 
+	  SqlEngine::load(std::string($2), std::string($4), SqlEngine::HASH_INDEX);
+	  free($2);
+	  free($4);
+	}
+	| LOAD table FROM STRING WITH VALUE HASH INDEX LF { 
+	  SqlEngine::load(std::string($2), std::string($4), SqlEngine::VALUE_HASH_INDEX);
 	  free($2);
 	  free($4);
 	}
 	;
 
+freeze_command:
+	FREEZE table LF {
+	  SqlEngine::freeze(std::string($2));
+	  free($2);
+	}
+	;
+
+create_command:
+	CREATE VALUE INDEX ON table LF {
+	  SqlEngine::createValueIndex(std::string($5));
+	  free($5);
+	}
+	;
+
+delete_command:
+	DELETE FROM table LF {
+	  std::vector<SelCond> conds;
+	  SqlEngine::remove(std::string($3), conds);
+	  free($3);
+	}
+	| DELETE FROM table WHERE conditions LF {
+	  SqlEngine::remove(std::string($3), *$5);
+	  free($3);
+	  for (unsigned i = 0; i < $5->size(); i++) {
+	    free((*$5)[i].value);
+	  }
+	  delete $5;
+	}
+	;
+
 select_command:
 	SELECT attributes FROM table LF {
    	        std::vector<SelCond> conds;
@@ -127,10 +185,11 @@ attributes:
 attribute:
 	ID { 
 		if (strcasecmp($1, "key") == 0) $$=1;
-		else if (strcasecmp($1, "value") == 0) $$=2;
 		else sqlerror("wrong attribute name. neither key or value");
 		free($1);
 	}
+	| VALUE { $$=2; }
+	;
 
 value:
 	INTEGER  { $$ = $1; }
@@ -0,0 +1,636 @@
+#include <climits>
+#include <cstring>
+#include "StringIndex.h"
+
+using namespace std;
+
+static_assert(sizeof(StringNodeBuffer) == PageFile::PAGE_SIZE &&
+              sizeof(StringIndexMetadata) == PageFile::PAGE_SIZE,
+              "a string index page must take exactly one page");
+static_assert(RecordFile::MAX_VALUE_LENGTH <= 255,
+              "a key length must fit in a byte");
+
+// the RecordId below all others. (key, MIN_RID) is the first entry a
+// search for the value key can start from.
+static const RecordId MIN_RID = { INT_MIN, INT_MIN };
+
+/*
+ * Compare the entries (k1, r1) and (k2, r2) by key, then by RecordId.
+ * The keys compare byte by byte as unsigned chars, as strcmp() does.
+ */
+static int compareEntry(const string& k1, const RecordId& r1, const string& k2, const RecordId& r2)
+{
+    int diff = k1.compare(k2);
+    if (diff != 0) {
+        return diff;
+    }
+    return r1 < r2 ? -1 : (r2 < r1 ? 1 : 0);
+}
+
+/*
+ * Find the smallest separator between the last entry of a node and the
+ * first entry of its right sibling: the shortest prefix of the right key
+ * that is greater than the left key. Only if the two keys are the same
+ * is the RecordId needed to tell the entries apart.
+ */
+static void separator(const string& left, const string& right, const RecordId& rightRid,
+                      string& key, RecordId& rid)
+{
+    if (left == right) {
+        key = right;
+        rid = rightRid;
+        return;
+    }
+    size_t n = 0;
+    while (n < left.size() && n < right.size() && left[n] == right[n]) {
+        n++;
+    }
+    key = right.substr(0, n + 1);
+    rid = MIN_RID;
+}
+
+StringNode::StringNode()
+{
+    leaf = true;
+    next = -1;
+    prev = -1;
+}
+
+/*
+ * Read the node from the page pid in the PageFile pf.
+ */
+RC StringNode::read(PageId pid, const PageFile& pf)
+{
+    StringNodeBuffer buffer;
+    RC error = pf.read(pid, &buffer);
+    if (error != 0) {
+        return error;
+    }
+    if ((buffer.type != IS_LEAF && buffer.type != IS_NODE) || buffer.count < 0) {
+        return RC_INVALID_FILE_FORMAT;
+    }
+
+    leaf = buffer.type == IS_LEAF;
+    keys.resize(buffer.count);
+    rids.resize(buffer.count);
+    children.clear();
+    next = prev = -1;
+    if (leaf) {
+        next = buffer.first;
+        prev = buffer.prev;
+    } else {
+        children.push_back(buffer.first);
+    }
+
+    const unsigned char* p = buffer.data;
+    const unsigned char* end = buffer.data + STRING_NODE_DATA;
+    for (int i = 0; i < buffer.count; i++) {
+        int entrySize = leaf ? 2 + 2 * sizeof(int) : 2 + 3 * sizeof(int);
+        if (p + 2 > end || p[0] > (i > 0 ? keys[i - 1].size() : 0) ||
+            p + entrySize + p[1] > end) {
+            return RC_INVALID_FILE_FORMAT;
+        }
+        int shared = p[0];
+        int length = p[1];
+        p += 2;
+        keys[i].assign(i > 0 ? keys[i - 1] : string(), 0, shared);
+        keys[i].append((const char*) p, length);
+        p += length;
+        memcpy(&rids[i].pid, p, sizeof(int));
+        memcpy(&rids[i].sid, p + sizeof(int), sizeof(int));
+        p += 2 * sizeof(int);
+        if (!leaf) {
+            PageId child;
+            memcpy(&child, p, sizeof(PageId));
+            children.push_back(child);
+            p += sizeof(PageId);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Write the node to the page pid in the PageFile pf.
+ */
+RC StringNode::write(PageId pid, PageFile& pf) const
+{
+    if (size() > STRING_NODE_DATA) {
+        return RC_NODE_FULL;
+    }
+
+    StringNodeBuffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    buffer.type = leaf ? IS_LEAF : IS_NODE;
+    buffer.count = keys.size();
+    buffer.first = leaf ? next : children[0];
+    buffer.prev = leaf ? prev : -1;
+
+    unsigned char* p = buffer.data;
+    for (unsigned i = 0; i < keys.size(); i++) {
+        size_t shared = 0;
+        if (i > 0) {
+            while (shared < keys[i].size() && shared < keys[i - 1].size() &&
+                   keys[i][shared] == keys[i - 1][shared]) {
+                shared++;
+            }
+        }
+        p[0] = shared;
+        p[1] = keys[i].size() - shared;
+        p += 2;
+        memcpy(p, keys[i].data() + shared, keys[i].size() - shared);
+        p += keys[i].size() - shared;
+        memcpy(p, &rids[i].pid, sizeof(int));
+        memcpy(p + sizeof(int), &rids[i].sid, sizeof(int));
+        p += 2 * sizeof(int);
+        if (!leaf) {
+            memcpy(p, &children[i + 1], sizeof(PageId));
+            p += sizeof(PageId);
+        }
+    }
+    return pf.write(pid, &buffer);
+}
+
+/*
+ * @return the number of bytes of the page data the entries take
+ */
+int StringNode::size() const
+{
+    int bytes = 0;
+    for (unsigned i = 0; i < keys.size(); i++) {
+        size_t shared = 0;
+        if (i > 0) {
+            while (shared < keys[i].size() && shared < keys[i - 1].size() &&
+                   keys[i][shared] == keys[i - 1][shared]) {
+                shared++;
+            }
+        }
+        bytes += 2 + (keys[i].size() - shared) + 2 * sizeof(int) + (leaf ? 0 : sizeof(PageId));
+    }
+    return bytes;
+}
+
+/*
+ * @return the position of the first entry >= (key, rid)
+ */
+int StringNode::lowerBound(const string& key, const RecordId& rid) const
+{
+    int lo = 0;
+    int hi = keys.size();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (compareEntry(keys[mid], rids[mid], key, rid) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*
+ * @return the child to follow for the entry (key, rid) in a nonleaf node:
+ *         the one behind the last separator <= (key, rid)
+ */
+int StringNode::child(const string& key, const RecordId& rid) const
+{
+    int lo = 0;
+    int hi = keys.size();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (compareEntry(keys[mid], rids[mid], key, rid) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*
+ * Find where to split the entries of a node that does not fit into its
+ * page: the first entry behind half of the bytes the entries take.
+ */
+static int splitPoint(const StringNode& node)
+{
+    int total = node.size();
+    StringNode half;
+    half.leaf = node.leaf;
+    unsigned m = 0;
+    while (m + 2 < node.keys.size()) {
+        half.keys.push_back(node.keys[m]);
+        half.rids.push_back(node.rids[m]);
+        if (half.size() >= total / 2) {
+            break;
+        }
+        m++;
+    }
+    return m + 1;
+}
+
+StringIndex::StringIndex()
+{
+    rootPid = -1;
+    treeHeight = 0;
+}
+
+/*
+ * Open the index file in read or write mode.
+ * Under 'w' mode, the index file is created if it does not exist.
+ * @param indexname[IN] the name of the index file
+ * @param mode[IN] 'r' for read, 'w' for write
+ * @return error code. 0 if no error
+ */
+RC StringIndex::open(const string& indexname, char mode)
+{
+    RC error = pf.open(indexname, mode);
+    if (error != 0) {
+        return error;
+    }
+
+    StringIndexMetadata meta;
+    if (pf.endPid() == 0) {
+        memset(&meta, 0, sizeof(meta));
+        meta.rootPid = rootPid = 1;
+        meta.treeHeight = treeHeight = 1;
+        StringNode root;
+        if ((error = pf.write(0, &meta)) != 0 || (error = root.write(rootPid, pf)) != 0) {
+            pf.close();
+        }
+        return error;
+    }
+
+    if ((error = pf.read(0, &meta)) != 0) {
+        pf.close();
+        return error;
+    }
+    rootPid = meta.rootPid;
+    treeHeight = meta.treeHeight;
+    return 0;
+}
+
+/*
+ * Close the index file.
+ * @return error code. 0 if no error
+ */
+RC StringIndex::close()
+{
+    return pf.close();
+}
+
+/*
+ * Insert (value, RecordId) pair to the index.
+ * @param key[IN] the value of the tuple
+ * @param rid[IN] the RecordId of the tuple
+ * @return error code. 0 if no error
+ */
+RC StringIndex::insert(const string& key, const RecordId& rid)
+{
+    if (key.size() > (size_t) RecordFile::MAX_VALUE_LENGTH) {
+        return RC_INVALID_ATTRIBUTE;
+    }
+
+    string   splitKey;
+    RecordId splitRid;
+    PageId   splitPid;
+    RC error = insertInto(rootPid, 0, key, rid, splitKey, splitRid, splitPid);
+    if (error != 0 || splitPid == -1) {
+        return error;
+    }
+
+    // the root split. the tree grows by a new root above the two halves.
+    StringNode root;
+    root.leaf = false;
+    root.children.push_back(rootPid);
+    root.keys.push_back(splitKey);
+    root.rids.push_back(splitRid);
+    root.children.push_back(splitPid);
+    PageId newRootPid = pf.endPid();
+    if ((error = root.write(newRootPid, pf)) != 0) {
+        return error;
+    }
+
+    StringIndexMetadata meta;
+    memset(&meta, 0, sizeof(meta));
+    meta.rootPid = newRootPid;
+    meta.treeHeight = treeHeight + 1;
+    if ((error = pf.write(0, &meta)) != 0) {
+        return error;
+    }
+    rootPid = newRootPid;
+    treeHeight++;
+    return 0;
+}
+
+/*
+ * Insert the pair into the subtree of the node pid at the given depth.
+ * If the node splits, splitPid is set to the page of its new right
+ * sibling and (splitKey, splitRid) to the separator of the two.
+ * Otherwise splitPid is -1.
+ */
+RC StringIndex::insertInto(PageId pid, int depth, const string& key, const RecordId& rid,
+                           string& splitKey, RecordId& splitRid, PageId& splitPid)
+{
+    RC error;
+    StringNode node;
+
+    splitPid = -1;
+    if ((error = node.read(pid, pf)) != 0) {
+        return error;
+    }
+
+    if (depth < treeHeight - 1) {
+        int c = node.child(key, rid);
+        string   childKey;
+        RecordId childRid;
+        PageId   childPid;
+        if ((error = insertInto(node.children[c], depth + 1, key, rid,
+                                childKey, childRid, childPid)) != 0 || childPid == -1) {
+            return error;
+        }
+        node.keys.insert(node.keys.begin() + c, childKey);
+        node.rids.insert(node.rids.begin() + c, childRid);
+        node.children.insert(node.children.begin() + c + 1, childPid);
+    } else {
+        int pos = node.lowerBound(key, rid);
+        node.keys.insert(node.keys.begin() + pos, key);
+        node.rids.insert(node.rids.begin() + pos, rid);
+    }
+
+    if (node.size() <= STRING_NODE_DATA) {
+        return node.write(pid, pf);
+    }
+
+    // split the node in two halves of about the same number of bytes
+    int m = splitPoint(node);
+    StringNode sibling;
+    sibling.leaf = node.leaf;
+    splitPid = pf.endPid();
+    if (node.leaf) {
+        sibling.keys.assign(node.keys.begin() + m, node.keys.end());
+        sibling.rids.assign(node.rids.begin() + m, node.rids.end());
+        node.keys.resize(m);
+        node.rids.resize(m);
+        separator(node.keys.back(), sibling.keys[0], sibling.rids[0], splitKey, splitRid);
+
+        sibling.next = node.next;
+        sibling.prev = pid;
+        node.next = splitPid;
+        if (sibling.next != -1) {
+            StringNode after;
+            if ((error = after.read(sibling.next, pf)) != 0) {
+                return error;
+            }
+            after.prev = splitPid;
+            if ((error = after.write(sibling.next, pf)) != 0) {
+                return error;
+            }
+        }
+    } else {
+        // the middle key moves up to the parent
+        splitKey = node.keys[m];
+        splitRid = node.rids[m];
+        sibling.keys.assign(node.keys.begin() + m + 1, node.keys.end());
+        sibling.rids.assign(node.rids.begin() + m + 1, node.rids.end());
+        sibling.children.assign(node.children.begin() + m + 1, node.children.end());
+        node.keys.resize(m);
+        node.rids.resize(m);
+        node.children.resize(m + 1);
+    }
+
+    if ((error = sibling.write(splitPid, pf)) != 0) {
+        return error;
+    }
+    return node.write(pid, pf);
+}
+
+/*
+ * Remove the (value, RecordId) pair from the index.
+ * @param key[IN] the value of the tuple
+ * @param rid[IN] the RecordId of the tuple
+ * @return error code. RC_NO_SUCH_RECORD if the pair is not in the index
+ */
+RC StringIndex::remove(const string& key, const RecordId& rid)
+{
+    RC error;
+    StringNode node;
+    PageId pid = rootPid;
+
+    for (int depth = 0; ; depth++) {
+        if ((error = node.read(pid, pf)) != 0) {
+            return error;
+        }
+        if (depth == treeHeight - 1) {
+            break;
+        }
+        pid = node.children[node.child(key, rid)];
+    }
+
+    int pos = node.lowerBound(key, rid);
+    if (pos == (int) node.keys.size() || node.keys[pos] != key || node.rids[pos] != rid) {
+        return RC_NO_SUCH_RECORD;
+    }
+    node.keys.erase(node.keys.begin() + pos);
+    node.rids.erase(node.rids.begin() + pos);
+    return node.write(pid, pf);
+}
+
+/*
+ * Start building the index bottom-up from pairs given in order.
+ * The root leaf of the empty index becomes the first leaf.
+ * @return error code. RC_INVALID_FILE_MODE if the index is not empty
+ */
+RC StringIndex::bulkLoadBegin()
+{
+    StringNode root;
+    RC error;
+    if (treeHeight != 1 || (error = root.read(rootPid, pf)) != 0 || !root.keys.empty()) {
+        return RC_INVALID_FILE_MODE;
+    }
+    bulkNodes.assign(1, root);
+    bulkPids.assign(1, rootPid);
+    return 0;
+}
+
+/*
+ * Append the next pair in (value, RecordId) order to the index being built.
+ * A leaf is filled until the next pair no longer fits, then written, and
+ * the separator to the next leaf goes up to the level above.
+ * @param key[IN] the value of the tuple
+ * @param rid[IN] the RecordId of the tuple
+ * @return error code. RC_UNSORTED_INPUT if the pair is out of order
+ */
+RC StringIndex::bulkLoadAppend(const string& key, const RecordId& rid)
+{
+    RC error;
+    if (bulkNodes.empty()) {
+        return RC_INVALID_FILE_MODE;
+    }
+    if (key.size() > (size_t) RecordFile::MAX_VALUE_LENGTH) {
+        return RC_INVALID_ATTRIBUTE;
+    }
+
+    StringNode& leaf = bulkNodes[0];
+    if (!leaf.keys.empty() && compareEntry(key, rid, leaf.keys.back(), leaf.rids.back()) < 0) {
+        return RC_UNSORTED_INPUT;
+    }
+    leaf.keys.push_back(key);
+    leaf.rids.push_back(rid);
+    if (leaf.size() <= STRING_NODE_DATA) {
+        return 0;
+    }
+    leaf.keys.pop_back();
+    leaf.rids.pop_back();
+
+    // the page of the next leaf is written right away, so that
+    // pf.endPid() does not hand it out again
+    StringNode next;
+    PageId oldPid = bulkPids[0];
+    PageId newPid = pf.endPid();
+    next.prev = oldPid;
+    if ((error = next.write(newPid, pf)) != 0) {
+        return error;
+    }
+    leaf.next = newPid;
+    if ((error = leaf.write(oldPid, pf)) != 0) {
+        return error;
+    }
+
+    string   sepKey;
+    RecordId sepRid;
+    separator(leaf.keys.back(), key, rid, sepKey, sepRid);
+    next.keys.push_back(key);
+    next.rids.push_back(rid);
+    bulkNodes[0] = next;
+    bulkPids[0] = newPid;
+    return bulkPush(1, sepKey, sepRid, newPid, oldPid);
+}
+
+/*
+ * Add the separator (key, rid) and the node pid behind it to the nonleaf
+ * node being filled at level. leftPid is the node in front of pid, which
+ * starts a new level above the current top.
+ */
+RC StringIndex::bulkPush(unsigned level, const string& key, const RecordId& rid,
+                         PageId pid, PageId leftPid)
+{
+    RC error;
+    if (level == bulkNodes.size()) {
+        StringNode top;
+        top.leaf = false;
+        top.children.push_back(leftPid);
+        PageId topPid = pf.endPid();
+        if ((error = top.write(topPid, pf)) != 0) {
+            return error;
+        }
+        bulkNodes.push_back(top);
+        bulkPids.push_back(topPid);
+    }
+
+    StringNode& node = bulkNodes[level];
+    node.keys.push_back(key);
+    node.rids.push_back(rid);
+    node.children.push_back(pid);
+    if (node.size() <= STRING_NODE_DATA) {
+        return 0;
+    }
+    node.keys.pop_back();
+    node.rids.pop_back();
+    node.children.pop_back();
+
+    // the node is full. pid starts the next node of the level,
+    // and key separates it from this one in the level above.
+    StringNode next;
+    next.leaf = false;
+    next.children.push_back(pid);
+    PageId oldPid = bulkPids[level];
+    PageId newPid = pf.endPid();
+    if ((error = next.write(newPid, pf)) != 0 || (error = node.write(oldPid, pf)) != 0) {
+        return error;
+    }
+    bulkNodes[level] = next;
+    bulkPids[level] = newPid;
+    return bulkPush(level + 1, key, rid, newPid, oldPid);
+}
+
+/*
+ * Write the nodes still being filled and finish the bulk load.
+ * @return error code. 0 if no error
+ */
+RC StringIndex::bulkLoadEnd()
+{
+    RC error;
+    if (bulkNodes.empty()) {
+        return RC_INVALID_FILE_MODE;
+    }
+    for (unsigned level = 0; level < bulkNodes.size(); level++) {
+        if ((error = bulkNodes[level].write(bulkPids[level], pf)) != 0) {
+            return error;
+        }
+    }
+
+    StringIndexMetadata meta;
+    memset(&meta, 0, sizeof(meta));
+    meta.rootPid = bulkPids.back();
+    meta.treeHeight = bulkNodes.size();
+    if ((error = pf.write(0, &meta)) != 0) {
+        return error;
+    }
+    rootPid = meta.rootPid;
+    treeHeight = meta.treeHeight;
+    bulkNodes.clear();
+    bulkPids.clear();
+    return 0;
+}
+
+/*
+ * Position a cursor at the first entry whose value is >= key.
+ * @param key[IN] the smallest value to return
+ * @param cursor[OUT] the cursor
+ * @return error code. 0 if no error
+ */
+RC StringIndex::locate(const string& key, StringCursor& cursor)
+{
+    RC error;
+    PageId pid = rootPid;
+
+    cursor.pid = -1;
+    for (int depth = 0; ; depth++) {
+        if ((error = cursor.leaf.read(pid, pf)) != 0) {
+            return error;
+        }
+        if (depth == treeHeight - 1) {
+            break;
+        }
+        pid = cursor.leaf.children[cursor.leaf.child(key, MIN_RID)];
+    }
+    cursor.pid = pid;
+    cursor.eid = cursor.leaf.lowerBound(key, MIN_RID);
+    return 0;
+}
+
+/*
+ * Read the entry at the cursor and move the cursor to the next one.
+ * @param cursor[IN/OUT] the cursor
+ * @param key[OUT] the value of the entry
+ * @param rid[OUT] the RecordId of the entry
+ * @return error code. RC_END_OF_TREE when there are no more entries
+ */
+RC StringIndex::readForward(StringCursor& cursor, string& key, RecordId& rid)
+{
+    RC error;
+    while (cursor.pid != -1 && cursor.eid >= (int) cursor.leaf.keys.size()) {
+        cursor.pid = cursor.leaf.next;
+        cursor.eid = 0;
+        if (cursor.pid != -1 && (error = cursor.leaf.read(cursor.pid, pf)) != 0) {
+            cursor.pid = -1;
+            return error;
+        }
+    }
+    if (cursor.pid == -1) {
+        return RC_END_OF_TREE;
+    }
+    key = cursor.leaf.keys[cursor.eid];
+    rid = cursor.leaf.rids[cursor.eid];
+    cursor.eid++;
+    return 0;
+}
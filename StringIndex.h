@@ -0,0 +1,192 @@
+#ifndef STRINGINDEX_H
+#define STRINGINDEX_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "BTreeNode.h"
+#include "PageFile.h"
+#include "RecordFile.h"
+
+/**
+ * The first page of a string index file.
+ */
+typedef struct {
+    PageId rootPid;
+    int    treeHeight;
+    int    unused[254];
+} StringIndexMetadata;
+
+const int STRING_NODE_DATA = PageFile::PAGE_SIZE - 4 * sizeof(int);
+
+/**
+ * The page layout of a node of a StringIndex. Each entry is stored as
+ *   [shared][length][length bytes of key][rid.pid][rid.sid]
+ * followed by [child PageId] in a nonleaf node, where the key is made of
+ * the first shared bytes of the key of the entry before it and the bytes
+ * that follow. Sorted keys share long prefixes, so most entries store
+ * only a few bytes of their key.
+ */
+typedef struct {
+    int    type;     // IS_LEAF or IS_NODE
+    int    count;    // # entries in the node
+    PageId first;    // leaf: the next leaf, -1 if none.
+                     // nonleaf: the child with the entries below the first key
+    PageId prev;     // leaf: the previous leaf, -1 if none
+    unsigned char data[STRING_NODE_DATA];
+} StringNodeBuffer;
+
+/**
+ * StringNode: a node of a StringIndex, decoded from its page.
+ * Entries are ordered by key and then by RecordId, so every entry has a
+ * place of its own even among many tuples with the same value. In a
+ * nonleaf node, children[i + 1] holds the entries >= (keys[i], rids[i])
+ * and children[0] those below the first of them.
+ */
+struct StringNode {
+    bool leaf;
+    std::vector<std::string> keys;
+    std::vector<RecordId>    rids;
+    std::vector<PageId>      children;
+    PageId next;    /// the next leaf, -1 if none
+    PageId prev;    /// the previous leaf, -1 if none
+
+    StringNode();
+
+   /**
+    * Read the node from the page pid in the PageFile pf.
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC read(PageId pid, const PageFile& pf);
+
+   /**
+    * Write the node to the page pid in the PageFile pf.
+    * @return 0 if successful. RC_NODE_FULL if the node does not fit in a page.
+    */
+    RC write(PageId pid, PageFile& pf) const;
+
+   /**
+    * @return the number of bytes of the page data the entries take
+    */
+    int size() const;
+
+   /**
+    * @return the position of the first entry >= (key, rid)
+    */
+    int lowerBound(const std::string& key, const RecordId& rid) const;
+
+   /**
+    * @return the child to follow for the entry (key, rid) in a nonleaf node
+    */
+    int child(const std::string& key, const RecordId& rid) const;
+};
+
+/**
+ * The position of a scan over a StringIndex. The scan keeps the leaf it
+ * is in decoded in memory.
+ */
+struct StringCursor {
+    StringNode leaf;  /// the leaf the scan is in
+    PageId     pid;   /// the PageId of leaf. -1 once the scan is done
+    int        eid;   /// the entry of leaf to return next
+};
+
+/**
+ * StringIndex: a B+tree secondary index on the value column.
+ * Keys are the values themselves, up to RecordFile::MAX_VALUE_LENGTH
+ * bytes each, front-compressed within a node. Splits push up the
+ * shortest prefix of the right node's first key that still separates
+ * it from the left node, so the nonleaf nodes hold short keys and the
+ * tree stays shallow. Duplicate values are told apart by RecordId.
+ *
+ * Removing entries does not merge nodes: a node may become underfull,
+ * or a leaf empty, and scans pass over empty leaves.
+ */
+class StringIndex {
+  public:
+    StringIndex();
+
+   /**
+    * Open the index file in read or write mode.
+    * Under 'w' mode, the index file is created if it does not exist.
+    * @param indexname[IN] the name of the index file
+    * @param mode[IN] 'r' for read, 'w' for write
+    * @return error code. 0 if no error
+    */
+    RC open(const std::string& indexname, char mode);
+
+   /**
+    * Close the index file.
+    * @return error code. 0 if no error
+    */
+    RC close();
+
+   /**
+    * Insert (value, RecordId) pair to the index.
+    * @param key[IN] the value of the tuple
+    * @param rid[IN] the RecordId of the tuple
+    * @return error code. 0 if no error
+    */
+    RC insert(const std::string& key, const RecordId& rid);
+
+   /**
+    * Remove the (value, RecordId) pair from the index.
+    * @param key[IN] the value of the tuple
+    * @param rid[IN] the RecordId of the tuple
+    * @return error code. RC_NO_SUCH_RECORD if the pair is not in the index
+    */
+    RC remove(const std::string& key, const RecordId& rid);
+
+   /**
+    * Start building the index bottom-up from pairs given in order.
+    * The index must be empty.
+    * @return error code. RC_INVALID_FILE_MODE if the index is not empty
+    */
+    RC bulkLoadBegin();
+
+   /**
+    * Append the next pair in (value, RecordId) order to the index being built.
+    * @param key[IN] the value of the tuple
+    * @param rid[IN] the RecordId of the tuple
+    * @return error code. RC_UNSORTED_INPUT if the pair is out of order
+    */
+    RC bulkLoadAppend(const std::string& key, const RecordId& rid);
+
+   /**
+    * Write the nodes still being filled and finish the bulk load.
+    * @return error code. 0 if no error
+    */
+    RC bulkLoadEnd();
+
+   /**
+    * Position a cursor at the first entry whose value is >= key.
+    * @param key[IN] the smallest value to return
+    * @param cursor[OUT] the cursor
+    * @return error code. 0 if no error
+    */
+    RC locate(const std::string& key, StringCursor& cursor);
+
+   /**
+    * Read the entry at the cursor and move the cursor to the next one.
+    * @param cursor[IN/OUT] the cursor
+    * @param key[OUT] the value of the entry
+    * @param rid[OUT] the RecordId of the entry
+    * @return error code. RC_END_OF_TREE when there are no more entries
+    */
+    RC readForward(StringCursor& cursor, std::string& key, RecordId& rid);
+
+  private:
+    RC insertInto(PageId pid, int depth, const std::string& key, const RecordId& rid,
+                  std::string& splitKey, RecordId& splitRid, PageId& splitPid);
+    RC bulkPush(unsigned level, const std::string& key, const RecordId& rid,
+                PageId pid, PageId leftPid);
+
+    PageFile pf;         /// the PageFile used to store the actual b+tree in disk
+    PageId   rootPid;    /// the PageId of the root node
+    int      treeHeight; /// the height of the tree
+
+    std::vector<StringNode> bulkNodes; /// the nodes a bulk load is filling, by level
+    std::vector<PageId>     bulkPids;  /// the pages of bulkNodes
+};
+
+#endif /* STRINGINDEX_H */
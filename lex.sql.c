@@ -387,8 +387,8 @@ static void yy_fatal_error (yyconst char msg[]  );
 	*yy_cp = '\0'; \
 	(yy_c_buf_p) = yy_cp;
 
-#define YY_NUM_RULES 26
-#define YY_END_OF_BUFFER 27
+#define YY_NUM_RULES 34
+#define YY_END_OF_BUFFER 35
 /* This struct is not used in this scanner,
    but its presence is necessary. */
 struct yy_trans_info
@@ -396,21 +396,28 @@ struct yy_trans_info
 	flex_int32_t yy_verify;
 	flex_int32_t yy_nxt;
 	};
-static yyconst flex_int16_t yy_accept[113] =
+static yyconst flex_int16_t yy_accept[190] =
     {   0,
-        0,    0,   27,   26,   25,   23,   26,   26,   22,   21,
-       26,   18,   24,   15,   12,   14,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   25,   23,    0,
-       19,   18,   17,   13,   16,   20,   20,   20,   20,   20,
-       20,   20,   11,   20,   20,   20,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   10,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,    8,    2,   20,
-        4,    7,   20,   20,    5,   20,   20,   20,   20,   20,
-
-        6,   20,    3,   20,   20,    0,    1,    0,    0,    0,
-        9,    0
+        0,    0,   35,   34,   33,   31,   34,   34,   30,   29,
+       34,   26,   32,   23,   20,   22,   28,   28,   28,   28,
+       28,   28,   28,   28,   28,   28,   28,   28,   28,   28,
+       28,   28,   28,   28,   28,   28,   28,   28,   28,   28,
+       28,   28,   28,   33,   31,    0,   27,   26,   25,   21,
+       24,   28,   28,   28,   28,   28,   28,   28,   28,   28,
+       28,   12,   19,   28,   28,   28,   28,   28,   28,   28,
+       28,   28,   28,   28,   28,   28,   28,   12,   19,   28,
+       28,   28,   28,   28,   18,   28,   28,   28,   28,   28,
+       28,   28,   28,   28,   28,   28,   28,   28,   28,   28,
+
+       18,   28,   28,   28,   28,   28,   28,   28,   28,   28,
+       28,   28,   28,   28,   28,   28,   28,   28,   28,   28,
+        8,   28,    2,   14,   28,    4,    7,   28,   28,   28,
+        5,   28,   28,   28,   28,    8,   28,    2,   14,   28,
+        4,    7,   28,   28,   28,    5,   28,   28,   28,   28,
+       28,    6,   28,   13,    3,   28,   28,   28,   28,   28,
+        6,   28,   13,    3,    0,   28,   28,   11,   10,    9,
+        1,    0,   28,   28,   11,   10,    9,    1,    0,   16,
+       28,    0,   16,   28,   17,   15,   17,   15,    0
     } ;
 
 static yyconst flex_int32_t yy_ec[256] =
@@ -422,13 +429,13 @@ static yyconst flex_int32_t yy_ec[256] =
         7,    8,    1,    9,   10,    1,    1,   11,   11,   11,
        11,   11,   11,   11,   11,   11,   11,    1,   12,   13,
        14,   15,    1,    1,   16,   17,   18,   19,   20,   21,
-       17,   22,   23,   17,   17,   24,   25,   26,   27,   17,
-       28,   29,   30,   31,   32,   17,   33,   34,   17,   17,
-        1,    1,    1,    1,   35,    1,   36,   17,   37,   38,
+       22,   23,   24,   17,   17,   25,   26,   27,   28,   17,
+       29,   30,   31,   32,   33,   34,   35,   36,   17,   37,
+        1,    1,    1,    1,   38,    1,   39,   17,   40,   41,
 
-       39,   40,   17,   41,   42,   17,   17,   43,   44,   45,
-       46,   17,   47,   48,   49,   50,   51,   17,   52,   53,
-       17,   17,    1,    1,    1,    1,    1,    1,    1,    1,
+       42,   43,   44,   45,   46,   17,   17,   47,   48,   49,
+       50,   17,   51,   52,   53,   54,   55,   56,   57,   58,
+       17,   59,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
@@ -445,100 +452,154 @@ static yyconst flex_int32_t yy_ec[256] =
         1,    1,    1,    1,    1
     } ;
 
-static yyconst flex_int32_t yy_meta[54] =
+static yyconst flex_int32_t yy_meta[60] =
     {   0,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    2,
-        2,    1,    1,    1,    1,    2,    2,    2,    2,    2,
-        2,    2,    2,    2,    2,    2,    2,    2,    2,    2,
-        2,    2,    2,    2,    2,    2,    2,    2,    2,    2,
-        2,    2,    2,    2,    2,    2,    2,    2,    2,    2,
-        2,    2,    2
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1,    1,    1,    1
     } ;
 
-static yyconst flex_int16_t yy_base[115] =
+static yyconst flex_int16_t yy_base[190] =
     {   0,
-        0,    0,  144,  145,  141,  145,  139,  136,  145,  145,
-      129,  128,  145,   40,  145,  124,  111,    0,  109,  101,
-      105,  107,  105,  102,   98,  109,   34,   83,   81,   73,
-       77,   79,   77,   74,   70,   81,   17,  117,  145,  113,
-      145,  106,  145,  145,  145,    0,   97,   83,   91,   86,
-       93,   95,    0,   87,   85,   88,   76,   68,   54,   62,
-       57,   64,   65,   58,   56,   59,   47,    0,   70,   64,
-       69,   73,   73,   60,   70,   60,   66,   42,   36,   41,
-       45,   45,   32,   42,   32,   38,   47,    0,    0,   43,
-        0,    0,   58,   55,    0,   24,   20,   35,   32,   64,
-
-        0,   38,    0,   62,   17,   58,    0,   57,   57,   56,
-      145,  145,   59,   60
+        0,    0,   60,  327,   59,  327,   59,   62,  327,  327,
+      111,    0,  327,  109,  327,  111,  116,  101,  101,  110,
+      140,  147,  162,  152,  152,  154,  149,  163,  169,  163,
+      139,  139,  148,  134,  141,  155,  146,  146,  148,  143,
+      157,  162,  157,    0,  327,    0,  327,    0,  327,  327,
+      327,    0,  185,  172,  187,  183,  185,  190,  180,  193,
+      197,    0,    0,  190,  190,  191,  197,  187,  179,  166,
+      181,  177,  179,  184,  174,  187,  190,    0,    0,  184,
+      184,  185,  191,  181,    0,  209,  217,  222,  219,  208,
+      221,  216,  220,  224,  226,  214,  227,  215,  219,  227,
+
+        0,  202,  210,  214,  212,  201,  214,  209,  213,  217,
+      219,  207,  220,  208,  212,  220,  234,  237,  236,  237,
+        0,  233,    0,    0,  235,    0,    0,  254,  253,  254,
+        0,  221,  224,  223,  224,    0,  220,    0,    0,  222,
+        0,    0,  241,  240,  241,    0,  278,  261,  266,  267,
+      268,    0,  257,    0,    0,  284,  245,  250,  251,  252,
+        0,  241,    0,    0,  288,  278,  272,    0,    0,    0,
+        0,  292,  260,  253,    0,    0,    0,    0,  296,    0,
+      282,  298,    0,  262,  327,    0,  327,    0,  327
     } ;
 
-static yyconst flex_int16_t yy_def[115] =
+static yyconst flex_int16_t yy_def[190] =
     {   0,
-      112,    1,  112,  112,  112,  112,  112,  113,  112,  112,
-      112,  112,  112,  112,  112,  112,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  112,  112,  113,
-      112,  112,  112,  112,  112,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-
-      114,  114,  114,  114,  114,  112,  114,  112,  112,  112,
-      112,    0,  112,  112
+      189,    1,  189,  189,  189,  189,  189,  189,  189,  189,
+      189,   11,  189,  189,  189,  189,  189,   17,   18,   18,
+       18,   18,   18,   17,   18,   17,   18,   18,   18,   18,
+       18,   18,   18,   18,   18,   18,   18,   18,   18,   18,
+       18,   18,   18,    5,  189,    8,  189,   11,  189,  189,
+      189,   18,   18,   18,   18,   18,   18,   18,   18,   18,
+       18,   18,   18,   18,   18,   18,   18,   18,   18,   18,
+       18,   18,   18,   18,   18,   18,   18,   18,   18,   18,
+       18,   18,   18,   18,   18,   17,   18,   18,   18,   18,
+       18,   18,   18,   18,   18,   18,   18,   18,   18,   18,
+
+       18,   18,   18,   18,   18,   18,   18,   18,   18,   18,
+       18,   18,   18,   18,   18,   18,   18,   18,   18,   18,
+       18,   18,   18,   18,   18,   18,   18,   18,   18,   18,
+       18,   18,   18,   18,   18,   18,   18,   18,   18,   18,
+       18,   18,   18,   18,   18,   18,   18,   18,   18,   18,
+       18,   18,   18,   18,   18,   18,   18,   18,   18,   18,
+       18,   18,   18,   18,  189,   18,   17,   18,   18,   18,
+       18,  189,   18,   18,   18,   18,   18,   18,  189,   18,
+       18,  189,   18,   18,  189,   18,  189,   18,    0
     } ;
 
-static yyconst flex_int16_t yy_nxt[199] =
+static yyconst flex_int16_t yy_nxt[387] =
     {   0,
         4,    5,    6,    7,    8,    4,    4,    9,   10,   11,
-       12,   13,   14,   15,   16,   17,   18,   19,   18,   20,
-       21,   18,   22,   23,   18,   18,   24,   25,   18,   26,
-       18,   18,   27,   18,    4,   28,   29,   18,   30,   31,
-       18,   32,   33,   18,   18,   34,   35,   18,   36,   18,
-       18,   37,   18,   43,   44,   56,   57,   66,   67,   40,
-       40,   46,  111,  111,  110,  109,  107,  108,  107,  106,
-      103,  105,  101,  104,  103,  102,  101,  100,   95,   99,
-       98,   92,   91,   97,   89,   88,   96,   95,   94,   93,
-       92,   91,   90,   89,   88,   87,   86,   85,   84,   83,
-
-       82,   81,   80,   79,   78,   68,   77,   76,   75,   74,
-       73,   72,   71,   70,   69,   68,   42,   41,   38,   65,
-       64,   53,   63,   62,   61,   60,   59,   58,   55,   54,
-       53,   52,   51,   50,   49,   48,   47,   45,   42,   42,
-       41,   39,   38,  112,    3,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112
-
+       12,   13,   14,   15,   16,   17,   18,   19,   20,   21,
+       22,   18,   23,   24,   25,   18,   18,   26,   27,   18,
+       28,   18,   18,   29,   30,   18,   18,    4,   31,   32,
+       33,   34,   35,   18,   36,   37,   38,   18,   18,   39,
+       40,   18,   41,   18,   18,   42,   43,   18,   18,  189,
+       44,   45,   46,   46,   46,   46,   47,   46,   46,   46,
+       46,   46,   46,   46,   46,   46,   46,   46,   46,   46,
+       46,   46,   46,   46,   46,   46,   46,   46,   46,   46,
+       46,   46,   46,   46,   46,   46,   46,   46,   46,   46,
+
+       46,   46,   46,   46,   46,   46,   46,   46,   46,   46,
+       46,   46,   46,   46,   46,   46,   46,   46,   46,   46,
+       46,   48,   49,   50,   51,   52,   52,   52,   54,   56,
+       55,   52,   52,   52,   52,   52,   52,   52,   52,   52,
+       52,   52,   53,   52,   52,   52,   52,   52,   52,   52,
+       52,   52,   52,   52,   52,   52,   52,   52,   52,   52,
+       52,   52,   52,   52,   52,   52,   52,   52,   52,   52,
+       52,   52,   52,   52,   52,   57,   58,   59,   60,   61,
+       62,   64,   65,   63,   66,   67,   68,   69,   70,   72,
+       71,   73,   74,   75,   76,   77,   78,   80,   81,   79,
+
+       82,   83,   84,   85,   86,   87,   88,   89,   90,   91,
+       93,   94,   95,   96,   97,   98,   99,   92,  100,  101,
+      102,  103,  104,  105,  106,  107,  109,  110,  111,  112,
+      113,  114,  115,  108,  116,  117,  118,  119,  120,  121,
+      122,  123,  124,  125,  126,  127,  128,  129,  130,  131,
+      132,  133,  134,  135,  136,  137,  138,  139,  140,  141,
+      142,  143,  144,  145,  146,  147,  148,  149,  150,  151,
+      152,  153,  154,  155,  156,  157,  158,  159,  160,  161,
+      162,  163,  164,  165,  167,  168,  169,  170,  171,  172,
+      174,  175,  176,  177,  178,  179,  180,  166,  181,  182,
+
+      183,  184,  185,  186,  187,  188,    0,    0,    0,    0,
+        0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+        0,    0,    0,    0,    0,  173,    3,  189,  189,  189,
+      189,  189,  189,  189,  189,  189,  189,  189,  189,  189,
+      189,  189,  189,  189,  189,  189,  189,  189,  189,  189,
+      189,  189,  189,  189,  189,  189,  189,  189,  189,  189,
+      189,  189,  189,  189,  189,  189,  189,  189,  189,  189,
+      189,  189,  189,  189,  189,  189,  189,  189,  189,  189,
+      189,  189,  189,  189,  189,  189
     } ;
 
-static yyconst flex_int16_t yy_chk[199] =
+static yyconst flex_int16_t yy_chk[387] =
     {   0,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,   14,   14,   27,   27,   37,   37,  113,
-      113,  114,  110,  109,  108,  106,  105,  104,  102,  100,
-       99,   98,   97,   96,   94,   93,   90,   87,   86,   85,
-       84,   83,   82,   81,   80,   79,   78,   77,   76,   75,
-       74,   73,   72,   71,   70,   69,   67,   66,   65,   64,
-
-       63,   62,   61,   60,   59,   58,   57,   56,   55,   54,
-       52,   51,   50,   49,   48,   47,   42,   40,   38,   36,
-       35,   34,   33,   32,   31,   30,   29,   28,   26,   25,
-       24,   23,   22,   21,   20,   19,   17,   16,   12,   11,
-        8,    7,    5,    3,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112
-
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    3,
+        5,    7,    8,    8,    8,    8,    8,    8,    8,    8,
+        8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+        8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+        8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+
+        8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+        8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+        8,   11,   14,   14,   16,   17,   17,   18,   19,   20,
+       19,   17,   17,   17,   17,   17,   17,   17,   17,   17,
+       17,   17,   17,   17,   17,   17,   17,   17,   17,   17,
+       17,   17,   17,   17,   17,   17,   17,   17,   17,   17,
+       17,   17,   17,   17,   17,   17,   17,   17,   17,   17,
+       17,   17,   17,   17,   17,   21,   22,   23,   24,   25,
+       26,   27,   28,   26,   29,   30,   30,   31,   32,   33,
+       32,   34,   35,   36,   37,   38,   39,   40,   41,   39,
+
+       42,   43,   43,   53,   54,   54,   55,   56,   57,   58,
+       59,   60,   61,   64,   65,   66,   67,   58,   68,   69,
+       70,   70,   71,   72,   73,   74,   75,   76,   77,   80,
+       81,   82,   83,   74,   84,   86,   87,   88,   89,   90,
+       91,   92,   93,   94,   95,   96,   97,   98,   99,  100,
+      102,  103,  104,  105,  106,  107,  108,  109,  110,  111,
+      112,  113,  114,  115,  116,  117,  118,  119,  120,  122,
+      125,  128,  129,  130,  132,  133,  134,  135,  137,  140,
+      143,  144,  145,  147,  148,  149,  150,  151,  153,  156,
+      157,  158,  159,  160,  162,  165,  166,  147,  167,  172,
+
+      173,  174,  179,  181,  182,  184,    0,    0,    0,    0,
+        0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+        0,    0,    0,    0,    0,  156,  189,  189,  189,  189,
+      189,  189,  189,  189,  189,  189,  189,  189,  189,  189,
+      189,  189,  189,  189,  189,  189,  189,  189,  189,  189,
+      189,  189,  189,  189,  189,  189,  189,  189,  189,  189,
+      189,  189,  189,  189,  189,  189,  189,  189,  189,  189,
+      189,  189,  189,  189,  189,  189,  189,  189,  189,  189,
+      189,  189,  189,  189,  189,  189
     } ;
 
 static yy_state_type yy_last_accepting_state;
@@ -570,7 +631,7 @@ char* strlower(char* s)
         }
 	return s;
 }
-#line 574 "lex.sql.c"
+#line 635 "lex.sql.c"
 
 #define INITIAL 0
 
@@ -760,7 +821,7 @@ YY_DECL
 #line 17 "SqlParser.l"
 
 
-#line 764 "lex.sql.c"
+#line 825 "lex.sql.c"
 
 	if ( !(yy_init) )
 		{
@@ -813,13 +874,13 @@ yy_match:
 			while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 				{
 				yy_current_state = (int) yy_def[yy_current_state];
-				if ( yy_current_state >= 113 )
+				if ( yy_current_state >= 190 )
 					yy_c = yy_meta[(unsigned int) yy_c];
 				}
 			yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
 			++yy_cp;
 			}
-		while ( yy_base[yy_current_state] != 145 );
+		while ( yy_base[yy_current_state] != 327 );
 
 yy_find_action:
 		yy_act = yy_accept[yy_current_state];
@@ -886,96 +947,136 @@ return QUIT;
 case 9:
 YY_RULE_SETUP
 #line 27 "SqlParser.l"
-return COUNT;
+return FREEZE;
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 29 "SqlParser.l"
-return AND;
+#line 28 "SqlParser.l"
+return DELETE;
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 30 "SqlParser.l"
-return OR;
+#line 29 "SqlParser.l"
+return CREATE;
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 31 "SqlParser.l"
-return EQUAL;
+#line 30 "SqlParser.l"
+return ON;
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 32 "SqlParser.l"
-return NEQUAL;
+#line 31 "SqlParser.l"
+return VALUE;
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 33 "SqlParser.l"
-return GREATER;
+#line 32 "SqlParser.l"
+return HASH;
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 34 "SqlParser.l"
-return LESS;
+#line 33 "SqlParser.l"
+return COVERING;
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 35 "SqlParser.l"
-return GREATEREQUAL;
+#line 34 "SqlParser.l"
+return COUNTED;
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 36 "SqlParser.l"
-return LESSEQUAL;
+#line 35 "SqlParser.l"
+return COUNT;
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 38 "SqlParser.l"
-sqllval.string = strdup(sqltext); return INTEGER;
+#line 37 "SqlParser.l"
+return AND;
 	YY_BREAK
 case 19:
-/* rule 19 can match eol */
 YY_RULE_SETUP
-#line 39 "SqlParser.l"
-sqllval.string = strdup(sqltext+1); sqllval.string[sqlleng-2] = 0; return STRING;
+#line 38 "SqlParser.l"
+return OR;
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 40 "SqlParser.l"
-sqllval.string = strlower(strdup(sqltext)); return ID;
+#line 39 "SqlParser.l"
+return EQUAL;
 	YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 41 "SqlParser.l"
-return COMMA;
+#line 40 "SqlParser.l"
+return NEQUAL;
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
-#line 42 "SqlParser.l"
-return STAR;
+#line 41 "SqlParser.l"
+return GREATER;
 	YY_BREAK
 case 23:
-/* rule 23 can match eol */
 YY_RULE_SETUP
-#line 43 "SqlParser.l"
-return LF;
+#line 42 "SqlParser.l"
+return LESS;
 	YY_BREAK
 case 24:
 YY_RULE_SETUP
-#line 44 "SqlParser.l"
-/* ignore semicolon */
+#line 43 "SqlParser.l"
+return GREATEREQUAL;
 	YY_BREAK
 case 25:
 YY_RULE_SETUP
-#line 45 "SqlParser.l"
-/* ignore white space */
+#line 44 "SqlParser.l"
+return LESSEQUAL;
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
+#line 46 "SqlParser.l"
+sqllval.string = strdup(sqltext); return INTEGER;
+	YY_BREAK
+case 27:
+/* rule 27 can match eol */
+YY_RULE_SETUP
 #line 47 "SqlParser.l"
+sqllval.string = strdup(sqltext+1); sqllval.string[sqlleng-2] = 0; return STRING;
+	YY_BREAK
+case 28:
+YY_RULE_SETUP
+#line 48 "SqlParser.l"
+sqllval.string = strlower(strdup(sqltext)); return ID;
+	YY_BREAK
+case 29:
+YY_RULE_SETUP
+#line 49 "SqlParser.l"
+return COMMA;
+	YY_BREAK
+case 30:
+YY_RULE_SETUP
+#line 50 "SqlParser.l"
+return STAR;
+	YY_BREAK
+case 31:
+/* rule 31 can match eol */
+YY_RULE_SETUP
+#line 51 "SqlParser.l"
+return LF;
+	YY_BREAK
+case 32:
+YY_RULE_SETUP
+#line 52 "SqlParser.l"
+/* ignore semicolon */
+	YY_BREAK
+case 33:
+YY_RULE_SETUP
+#line 53 "SqlParser.l"
+/* ignore white space */
+	YY_BREAK
+case 34:
+YY_RULE_SETUP
+#line 55 "SqlParser.l"
 ECHO;
 	YY_BREAK
-#line 979 "lex.sql.c"
+#line 1080 "lex.sql.c"
 case YY_STATE_EOF(INITIAL):
 	yyterminate();
 
@@ -1267,7 +1368,7 @@ static int yy_get_next_buffer (void)
 		while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 			{
 			yy_current_state = (int) yy_def[yy_current_state];
-			if ( yy_current_state >= 113 )
+			if ( yy_current_state >= 190 )
 				yy_c = yy_meta[(unsigned int) yy_c];
 			}
 		yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
@@ -1295,11 +1396,11 @@ static int yy_get_next_buffer (void)
 	while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 		{
 		yy_current_state = (int) yy_def[yy_current_state];
-		if ( yy_current_state >= 113 )
+		if ( yy_current_state >= 190 )
 			yy_c = yy_meta[(unsigned int) yy_c];
 		}
 	yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
-	yy_is_jam = (yy_current_state == 112);
+	yy_is_jam = (yy_current_state == 189);
 
 	return yy_is_jam ? 0 : yy_current_state;
 }